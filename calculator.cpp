@@ -1,15 +1,82 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <optional>
-#include <stack>
+#include <random>
 #include <sstream>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#if defined(__unix__)
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+// heap allocations made by the current thread, lets the benchmarks show which paths allocate in steady state and
+// --check assert it for evaluation and for the REPL's cached path; per thread, so that batch workers do not share a counter, and every path that is measured
+// runs on the thread that reads it
+thread_local size_t allocation_count = 0;
+
+// kept out of line, so the compiler does not pair the inlined malloc and free with the wrong operators
+[[gnu::noinline]] void* operator new(size_t size) {
+    allocation_count++;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
 // help message
-const std::string HELPMSG = "help (h): display this message\nquit (q): quit the program\n";
+const std::string HELPMSG = "help (h): display this message\nstats: show result cache statistics\ntiers: show the execution tier and time of each expression\nquit (q): quit the program\n";
 
 // special characters as class
 struct special_char {
@@ -25,15 +92,25 @@ struct special_char {
     type value;
 };
 
+// named variable, referring to a slot in the variable table the expression was parsed with
+struct variable {
+    size_t index;
+};
+
+// variable names in slot order
+using variable_table = std::vector<std::string>;
+
 // expression token descriptor
 template <typename T, typename U = special_char>
-using token = std::variant<T, U>;
+using token = std::variant<T, U, variable>;
 
 // stream interaction for tokens
 template <typename T>
 std::ostream& operator<<(std::ostream& out, const token<T>& token) {
     if (std::holds_alternative<T>(token)) {
         out << std::get<T>(token);
+    } else if (std::holds_alternative<variable>(token)) {
+        out << "$" << std::get<variable>(token).index;
     } else {
         out << (char)std::get<special_char>(token).value;
     }
@@ -41,218 +118,6505 @@ std::ostream& operator<<(std::ostream& out, const token<T>& token) {
     return out;
 }
 
-// expression parser
+// characters that may start or continue a variable name
+constexpr bool is_identifier_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+constexpr bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// decimal literal conversion usable in constant expressions, reads the longest valid prefix like std::from_chars;
+// exact when the digits fit a double mantissa and the exponent is within 10^22, otherwise within an ulp or two,
+// so float and double take the correctly rounded conversions below instead
 template <typename T>
-std::vector<token<T>> parse(const std::optional<token<T>>& previous_result, const std::string& expression) {
-    std::vector<token<T>> tokens;
-    std::istringstream iss(expression);
+constexpr T parse_decimal(std::string_view literal) {
+    const uint64_t MANTISSA_LIMIT = 1000000000000000000u;
+    size_t i = 0;
+    bool negative = i < literal.size() && literal[i] == '-';
+    i += negative;
 
-    if (previous_result.has_value()) {
-        tokens.push_back(previous_result.value());
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool any_digits = false;
+    for (; i < literal.size() && is_digit(literal[i]); i++, any_digits = true) {
+        if (mantissa < MANTISSA_LIMIT) {
+            mantissa = mantissa * 10 + (literal[i] - '0');
+        } else {
+            exponent++;
+        }
     }
 
-    char new_char;
-    char prev_char = previous_result.has_value() ? '0' : '\0';
-    std::string buffer;
-
-    while (iss.get(new_char)) {
-        switch (new_char) {
-            case '-':
-                // handle unary minus check
-                if (!(prev_char >= '0' && prev_char <= '9') && prev_char != ')') {
-                    if (buffer != "") {
-                        buffer = "";
-                        break;
-                    }
-                    buffer += new_char;
-                    break;
-                }
-            case '+':
-            case '*':
-            case '/':
-            case ')':
-                if (buffer != "") {
-                    T value;
-                    std::stringstream(buffer) >> value;
-                    tokens.push_back(value);
-                    buffer = "";
+    if constexpr (std::is_floating_point_v<T>) {
+        if (i < literal.size() && literal[i] == '.') {
+            for (i++; i < literal.size() && is_digit(literal[i]); i++, any_digits = true) {
+                if (mantissa < MANTISSA_LIMIT) {
+                    mantissa = mantissa * 10 + (literal[i] - '0');
+                    exponent--;
                 }
+            }
+        }
 
-                tokens.push_back(special_char{static_cast<special_char::type>(new_char)});
-                break;
-            case '(':
-                if (prev_char == ')') {
-                    tokens.push_back(special_char{special_char::MULTIPLY});
-                    prev_char = '*';
-                }
+        // an exponent only counts if it has digits
+        if (any_digits && i < literal.size() && (literal[i] == 'e' || literal[i] == 'E')) {
+            size_t j = i + 1;
+            bool negative_exponent = j < literal.size() && literal[j] == '-';
+            j += j < literal.size() && (literal[j] == '-' || literal[j] == '+');
+            size_t exponent_begin = j;
+            int written_exponent = 0;
+            for (; j < literal.size() && is_digit(literal[j]); j++) {
+                written_exponent = std::min(written_exponent * 10 + (literal[j] - '0'), 100000);
+            }
+            if (j > exponent_begin) {
+                exponent += negative_exponent ? -written_exponent : written_exponent;
+            }
+        }
+    }
 
-                if (prev_char == '-' && buffer != "") {
-                    buffer += '1';
-                    T value;
-                    std::stringstream(buffer) >> value;
-                    tokens.push_back(value);
-                    buffer = "";
-                    tokens.push_back(special_char{special_char::MULTIPLY});
-                    prev_char = '*';
-                }
+    if (!any_digits) {
+        return T{};
+    }
 
-                if (buffer != "") {
-                    T value;
-                    std::stringstream(buffer) >> value;
-                    tokens.push_back(value);
-                    buffer = "";
-                }
+    if constexpr (std::is_floating_point_v<T>) {
+        // both the mantissa and 10^|exponent| are exact doubles, so a single rounding happens
+        double power = 1;
+        for (int k = 0; k < std::min(exponent < 0 ? -exponent : exponent, 22); k++) {
+            power *= 10;
+        }
 
-                if (prev_char != '(' && prev_char != '+' && prev_char != '-' && prev_char != '*' && prev_char != '/' && prev_char != '\0') {
-                    tokens.push_back(special_char{special_char::MULTIPLY});
-                    prev_char = '*';
-                }
-                
-                tokens.push_back(special_char{static_cast<special_char::type>(new_char)});
+        T value;
+        if (mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+            value = static_cast<T>(exponent < 0 ? mantissa / power : mantissa * power);
+        } else {
+            long double scaled = mantissa;
+            for (int k = 0; k < exponent; k++) {
+                scaled *= 10;
+            }
+            for (int k = 0; k > exponent; k--) {
+                scaled /= 10;
+            }
+            // converting a value beyond the range of T is not a constant expression
+            value = scaled > std::numeric_limits<T>::max() ? std::numeric_limits<T>::infinity() : static_cast<T>(scaled);
+        }
+        return negative ? -value : value;
+    } else {
+        return static_cast<T>(negative ? -static_cast<int64_t>(mantissa) : static_cast<int64_t>(mantissa));
+    }
+}
+
+// IEEE layout of the binary format a literal is converted to
+template <typename T>
+struct binary_format;
+
+template <>
+struct binary_format<double> {
+    using bits = uint64_t;
+    static constexpr int mantissa_bits = 52;
+    static constexpr int minimum_exponent = -1023;
+    static constexpr int infinite_power = 0x7ff;
+    static constexpr int smallest_power_of_ten = -342;
+    static constexpr int largest_power_of_ten = 308;
+    static constexpr int min_exponent_round_to_even = -4;
+    static constexpr int max_exponent_round_to_even = 23;
+    // Clinger's fast path: the significand and the power of ten are both exact, so one operation rounds correctly
+    static constexpr uint64_t max_exact_significand = uint64_t(1) << 53;
+    static constexpr int max_exact_power_of_ten = 22;
+};
+
+template <>
+struct binary_format<float> {
+    using bits = uint32_t;
+    static constexpr int mantissa_bits = 23;
+    static constexpr int minimum_exponent = -127;
+    static constexpr int infinite_power = 0xff;
+    static constexpr int smallest_power_of_ten = -65;
+    static constexpr int largest_power_of_ten = 38;
+    static constexpr int min_exponent_round_to_even = -17;
+    static constexpr int max_exponent_round_to_even = 10;
+    static constexpr uint64_t max_exact_significand = uint64_t(1) << 24;
+    static constexpr int max_exact_power_of_ten = 10;
+};
+
+// Eisel-Lemire conversion of decimal literals to float and double, needs 128-bit products
+#if defined(__SIZEOF_INT128__)
+#define FAST_FLOAT_AVAILABLE 1
+#else
+#define FAST_FLOAT_AVAILABLE 0
+#endif
+
+#if FAST_FLOAT_AVAILABLE
+// powers of five the conversion multiplies by, from 5^-342 to 5^308
+const int SMALLEST_POWER_OF_FIVE = -342;
+const int LARGEST_POWER_OF_FIVE = 308;
+
+// 5^q as 128-bit mantissas with the top bit set, high word first: truncated for q >= 0, and for q < 0 the quotient
+// 2^b / 5^-q plus one, truncated to 128 bits; computed during compilation with multiword integers, dividing one
+// large power of two by five repeatedly instead of dividing by every power separately
+constexpr std::array<uint64_t, 2 * (LARGEST_POWER_OF_FIVE - SMALLEST_POWER_OF_FIVE + 1)> power_of_five_table() {
+    using wide = std::array<uint64_t, 28>;
+    const size_t WIDE_BITS = 28 * 64;
+
+    auto bit_length = [](const wide& number) -> size_t {
+        for (size_t word = number.size(); word-- > 0;) {
+            if (number[word] != 0) {
+                return word * 64 + 64 - std::countl_zero(number[word]);
+            }
+        }
+        return 0;
+    };
+    // bits [bit, bit + 64) of number, zero above its top word
+    auto word_at = [](const wide& number, size_t bit) -> uint64_t {
+        size_t word = bit / 64, shift = bit % 64;
+        uint64_t low = word < number.size() ? number[word] >> shift : 0;
+        uint64_t high = shift != 0 && word + 1 < number.size() ? number[word + 1] << (64 - shift) : 0;
+        return low | high;
+    };
+    // top 128 bits of number, shifted up when it is shorter
+    auto top_bits = [&](const wide& number, uint64_t* out) {
+        size_t length = bit_length(number);
+        if (length >= 128) {
+            out[0] = word_at(number, length - 64);
+            out[1] = word_at(number, length - 128);
+        } else {
+            unsigned __int128 value = static_cast<unsigned __int128>(number[1]) << 64 | number[0];
+            value <<= 128 - length;
+            out[0] = static_cast<uint64_t>(value >> 64);
+            out[1] = static_cast<uint64_t>(value);
+        }
+    };
+
+    std::array<uint64_t, 2 * (LARGEST_POWER_OF_FIVE - SMALLEST_POWER_OF_FIVE + 1)> table{};
+
+    // quotient holds floor(2^WIDE_BITS-1 / 5^k), power holds 5^k
+    wide quotient{}, power{};
+    quotient.back() = uint64_t(1) << 63;
+    power[0] = 1;
+    for (int k = 1; k <= -SMALLEST_POWER_OF_FIVE; k++) {
+        unsigned __int128 remainder = 0;
+        for (size_t word = quotient.size(); word-- > 0;) {
+            unsigned __int128 current = remainder << 64 | quotient[word];
+            quotient[word] = static_cast<uint64_t>(current / 5);
+            remainder = current % 5;
+        }
+        unsigned __int128 carry = 0;
+        for (auto& word : power) {
+            unsigned __int128 current = static_cast<unsigned __int128>(word) * 5 + carry;
+            word = static_cast<uint64_t>(current);
+            carry = current >> 64;
+        }
+
+        // floor(2^b / 5^k) + 1 with b = z + 127 for k <= 27 and b = 2z + 128 above, z the bit length of 5^k
+        size_t z = bit_length(power);
+        size_t b = k <= 27 ? z + 127 : 2 * z + 128;
+        size_t shift = WIDE_BITS - 1 - b;
+        wide rounded{};
+        for (size_t word = 0; word < rounded.size(); word++) {
+            rounded[word] = word_at(quotient, shift + word * 64);
+        }
+        for (auto& word : rounded) {
+            if (++word != 0) {
                 break;
-            default:
-                if (prev_char == ')') {
-                    tokens.push_back(special_char{special_char::MULTIPLY});
-                    prev_char = '*';
-                }
-                buffer += new_char;
+            }
         }
+        top_bits(rounded, &table[2 * (-k - SMALLEST_POWER_OF_FIVE)]);
+    }
 
-        prev_char = new_char;
+    power = wide{};
+    power[0] = 1;
+    for (int q = 0; q <= LARGEST_POWER_OF_FIVE; q++) {
+        top_bits(power, &table[2 * (q - SMALLEST_POWER_OF_FIVE)]);
+        unsigned __int128 carry = 0;
+        for (auto& word : power) {
+            unsigned __int128 current = static_cast<unsigned __int128>(word) * 5 + carry;
+            word = static_cast<uint64_t>(current);
+            carry = current >> 64;
+        }
     }
 
-    if (buffer != "") {
-        T value;
-        std::stringstream(buffer) >> value;
-        tokens.push_back(value);
-        buffer = "";
+    return table;
+}
+
+constexpr auto POWERS_OF_FIVE = power_of_five_table();
+static_assert(POWERS_OF_FIVE[0] == 0xeef453d6923bd65a && POWERS_OF_FIVE[1] == 0x113faa2906a13b3f);
+static_assert(POWERS_OF_FIVE[2 * 341] == 0xcccccccccccccccc && POWERS_OF_FIVE[2 * 341 + 1] == 0xcccccccccccccccd);
+
+// correctly rounded w * 10^q as a biased exponent and mantissa without the implicit bit; a biased exponent of 0 or of
+// infinite_power means a subnormal, zero or infinite result, which is left to the full conversion
+template <typename T>
+constexpr std::pair<int, uint64_t> eisel_lemire(int64_t q, uint64_t w) {
+    using format = binary_format<T>;
+    if (q < format::smallest_power_of_ten) {
+        return {0, 0};
+    }
+    if (q > format::largest_power_of_ten) {
+        return {format::infinite_power, 0};
     }
 
-    return tokens;
+    int leading_zeros = std::countl_zero(w);
+    w <<= leading_zeros;
+
+    // the high product is exact enough unless its bits below the mantissa precision are all ones
+    size_t index = 2 * static_cast<size_t>(q - SMALLEST_POWER_OF_FIVE);
+    unsigned __int128 product = static_cast<unsigned __int128>(w) * POWERS_OF_FIVE[index];
+    uint64_t high = static_cast<uint64_t>(product >> 64), low = static_cast<uint64_t>(product);
+    const uint64_t precision_mask = ~uint64_t(0) >> (format::mantissa_bits + 3);
+    if ((high & precision_mask) == precision_mask) {
+        uint64_t second = static_cast<uint64_t>((static_cast<unsigned __int128>(w) * POWERS_OF_FIVE[index + 1]) >> 64);
+        low += second;
+        high += second > low;
+    }
+
+    int upper_bit = static_cast<int>(high >> 63);
+    uint64_t mantissa = high >> (upper_bit + 64 - format::mantissa_bits - 3);
+    int power2 = static_cast<int>(((152170 + 65536) * q) >> 16) + 63 + upper_bit - leading_zeros - format::minimum_exponent;
+    if (power2 <= 0) {
+        return {0, 0};
+    }
+
+    // exactly halfway between two floats, which only happens for small powers of ten: round to even
+    if (low <= 1 && q >= format::min_exponent_round_to_even && q <= format::max_exponent_round_to_even && (mantissa & 3) == 1
+        && (mantissa << (upper_bit + 64 - format::mantissa_bits - 3)) == high) {
+        mantissa &= ~uint64_t(1);
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (uint64_t(2) << format::mantissa_bits)) {
+        mantissa = uint64_t(1) << format::mantissa_bits;
+        power2++;
+    }
+    mantissa &= ~(uint64_t(1) << format::mantissa_bits);
+    return {std::min(power2, format::infinite_power), mantissa};
+}
+
+// eight ASCII digits at once, little-endian: checks them with two masks and combines them in three multiplications
+constexpr bool is_eight_digits(uint64_t chunk) {
+    return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
+
+constexpr uint32_t parse_eight_digits(uint64_t chunk) {
+    chunk -= 0x3030303030303030;
+    chunk = chunk * 10 + (chunk >> 8);
+    chunk = ((chunk & 0x000000FF000000FF) * 0x000F424000000064 + ((chunk >> 16) & 0x000000FF000000FF) * 0x0000271000000001) >> 32;
+    return static_cast<uint32_t>(chunk);
+}
+
+// eight bytes as a little-endian word, one load at run time
+constexpr uint64_t load_eight(const char* p) {
+    uint64_t chunk = 0;
+    if (std::is_constant_evaluated()) {
+        for (int i = 7; i >= 0; i--) {
+            chunk = chunk << 8 | static_cast<unsigned char>(p[i]);
+        }
+    } else {
+        std::memcpy(&chunk, p, 8);
+    }
+    return chunk;
 }
 
-// expression evaluator
+// the longest decimal literal prefix, like std::from_chars, converted with Clinger's fast path or Eisel-Lemire;
+// a significand longer than 19 digits is truncated, and kept when rounding the truncated value and the next one up
+// agree; false for what this does not cover, which is no digits, ambiguous truncations, and results that are
+// subnormal, zero or out of range, so the caller falls back to the full conversion
 template <typename T>
-T evaluate(const std::vector<token<T>>& expression) {
-    // convert to postfix notation using shunting yard algorithm
-    std::vector<token<T>> infix_expression, postfix_expression;
-    std::stack<token<T>> stack;
+constexpr bool parse_float_fast(std::string_view literal, T& value) {
+    using format = binary_format<T>;
+    const char* p = literal.data();
+    const char* end = p + literal.size();
+    bool negative = p != end && *p == '-';
+    p += negative;
 
-    infix_expression = expression;
-    std::reverse(infix_expression.begin(), infix_expression.end());
+    // digits accumulate with wrap-around, they are only used when there are at most 19 of them
+    uint64_t significand = 0;
+    const char* integer_begin = p;
+    while (p != end && is_digit(*p)) {
+        significand = significand * 10 + static_cast<uint64_t>(*p++ - '0');
+    }
+    const char* integer_end = p;
+    int64_t digits = integer_end - integer_begin;
 
-    while (!infix_expression.empty()) {
-        token<T> token = infix_expression.back();
-        infix_expression.pop_back();
+    const char* fraction_begin = p;
+    const char* fraction_end = p;
+    int64_t exponent = 0;
+    if (p != end && *p == '.') {
+        fraction_begin = ++p;
+        uint64_t chunk = 0;
+        while (end - p >= 8 && is_eight_digits(chunk = load_eight(p))) {
+            significand = significand * 100000000 + parse_eight_digits(chunk);
+            p += 8;
+        }
+        while (p != end && is_digit(*p)) {
+            significand = significand * 10 + static_cast<uint64_t>(*p++ - '0');
+        }
+        fraction_end = p;
+        exponent = fraction_begin - fraction_end;
+        digits -= exponent;
+    }
+    if (digits == 0) {
+        return false;
+    }
 
-        if (std::holds_alternative<T>(token)) {
-            postfix_expression.push_back(token);
-            continue;
+    // an exponent only counts when digits follow the e and its sign
+    int64_t written_exponent = 0;
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negative_exponent = q != end && *q == '-';
+        q += q != end && (*q == '-' || *q == '+');
+        for (; q != end && is_digit(*q); q++) {
+            written_exponent = std::min<int64_t>(written_exponent * 10 + (*q - '0'), 100000);
         }
+        written_exponent = negative_exponent ? -written_exponent : written_exponent;
+    }
+    exponent += written_exponent;
 
-        // the token is a special character
-        switch (std::get<special_char>(token).value) {
-            case special_char::PLUS:
-                while (!stack.empty() && std::get<special_char>(stack.top()).value != special_char::LEFT_PARENTHESIS) {
-                    postfix_expression.push_back(stack.top());
-                    stack.pop();
-                }
-                stack.push(token);
-                break;
-            case special_char::MINUS:
-                while (!stack.empty() && std::get<special_char>(stack.top()).value != special_char::LEFT_PARENTHESIS) {
-                    postfix_expression.push_back(stack.top());
-                    stack.pop();
-                }
-                stack.push(token);
-                break;
-            case special_char::MULTIPLY:
-            case special_char::DIVIDE:
-            case special_char::LEFT_PARENTHESIS:
-                stack.push(token);
-                break;
-            case special_char::RIGHT_PARENTHESIS:
-                while (!stack.empty() && std::get<special_char>(stack.top()).value != special_char::LEFT_PARENTHESIS) {
-                    postfix_expression.push_back(stack.top());
-                    stack.pop();
+    // leading zeros do not count towards the 19 digits
+    bool truncated = false;
+    if (digits > 19) {
+        for (const char* zero = integer_begin; zero != end && (*zero == '0' || *zero == '.'); zero++) {
+            digits -= *zero == '0';
+        }
+        if (digits > 19) {
+            truncated = true;
+            significand = 0;
+            const char* digit = integer_begin;
+            while (significand < 1000000000000000000 && digit != integer_end) {
+                significand = significand * 10 + static_cast<uint64_t>(*digit++ - '0');
+            }
+            if (significand >= 1000000000000000000) {
+                exponent = (integer_end - digit) + written_exponent;
+            } else {
+                digit = fraction_begin;
+                while (significand < 1000000000000000000 && digit != fraction_end) {
+                    significand = significand * 10 + static_cast<uint64_t>(*digit++ - '0');
                 }
-                stack.pop();
-                break;
+                exponent = (fraction_begin - digit) + written_exponent;
+            }
         }
     }
 
-    while (!stack.empty()) {
-        postfix_expression.push_back(stack.top());
-        stack.pop();
+    if (significand == 0) {
+        value = negative ? -T(0) : T(0);
+        return true;
     }
 
-    // evaluate postfix expression
-    for (auto current_token : postfix_expression) {
-        if (std::holds_alternative<T>(current_token)) {
-            stack.push(current_token);
+    if (!truncated && significand <= format::max_exact_significand && exponent >= -format::max_exact_power_of_ten
+        && exponent <= format::max_exact_power_of_ten) {
+        constexpr T powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        value = static_cast<T>(significand);
+        value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+        value = negative ? -value : value;
+        return true;
+    }
+
+    auto [power2, mantissa] = eisel_lemire<T>(exponent, significand);
+    if (power2 <= 0 || power2 >= format::infinite_power) {
+        return false;
+    }
+    if (truncated && eisel_lemire<T>(exponent, significand + 1) != std::pair(power2, mantissa)) {
+        return false;
+    }
+    auto bits = static_cast<typename format::bits>(mantissa | static_cast<uint64_t>(power2) << format::mantissa_bits);
+    bits |= static_cast<typename format::bits>(negative) << (sizeof(bits) * 8 - 1);
+    value = std::bit_cast<T>(bits);
+    return true;
+}
+#endif
+
+// correctly rounded conversion of float and double literals in constant expressions, for what the fast path leaves:
+// the literal is held as an exact fraction of multiword integers, scaled so that long division yields the mantissa
+// plus a round bit, and the remainder tells whether the rest is zero; slow, but it only runs during compilation
+template <typename T>
+constexpr T parse_decimal_exact(std::string_view literal) {
+    using format = binary_format<T>;
+    using wide = std::vector<uint32_t>;
+    const int PRECISION = format::mantissa_bits + 1;
+    // the quotient is taken with one bit below the last mantissa bit of the smallest subnormal
+    const int64_t SMALLEST_SHIFT = format::minimum_exponent + 2 - PRECISION - 1;
+
+    // multiword integers, least significant limb first, without leading zero limbs; zero is empty
+    auto multiply_add = [](wide& number, uint32_t factor, uint32_t addend) {
+        uint64_t carry = addend;
+        for (auto& limb : number) {
+            uint64_t current = static_cast<uint64_t>(limb) * factor + carry;
+            limb = static_cast<uint32_t>(current);
+            carry = current >> 32;
+        }
+        if (carry != 0) {
+            number.push_back(static_cast<uint32_t>(carry));
+        }
+    };
+    auto bit_length = [](const wide& number) -> int64_t {
+        return number.empty() ? 0 : static_cast<int64_t>(number.size()) * 32 - std::countl_zero(number.back());
+    };
+    auto shift_left = [](wide& number, int64_t bits) {
+        if (number.empty()) {
+            return;
+        }
+        number.insert(number.begin(), static_cast<size_t>(bits / 32), 0);
+        if (int shift = static_cast<int>(bits % 32); shift != 0) {
+            uint32_t carry = 0;
+            for (auto& limb : number) {
+                uint32_t next = limb >> (32 - shift);
+                limb = limb << shift | carry;
+                carry = next;
+            }
+            if (carry != 0) {
+                number.push_back(carry);
+            }
+        }
+    };
+    auto less = [](const wide& lhs, const wide& rhs) {
+        if (lhs.size() != rhs.size()) {
+            return lhs.size() < rhs.size();
+        }
+        for (size_t limb = lhs.size(); limb-- > 0;) {
+            if (lhs[limb] != rhs[limb]) {
+                return lhs[limb] < rhs[limb];
+            }
+        }
+        return false;
+    };
+    auto subtract = [](wide& lhs, const wide& rhs) {
+        int64_t borrow = 0;
+        for (size_t limb = 0; limb < lhs.size(); limb++) {
+            int64_t current = static_cast<int64_t>(lhs[limb]) - borrow - (limb < rhs.size() ? rhs[limb] : 0);
+            borrow = current < 0;
+            lhs[limb] = static_cast<uint32_t>(current + (borrow << 32));
+        }
+        while (!lhs.empty() && lhs.back() == 0) {
+            lhs.pop_back();
+        }
+    };
+
+    size_t i = 0;
+    bool negative = i < literal.size() && literal[i] == '-';
+    i += negative;
+
+    // every digit counts, leading zeros only move the exponent
+    wide numerator;
+    int64_t exponent = 0, significant_digits = 0;
+    bool any_digits = false, point = false;
+    for (; i < literal.size() && (is_digit(literal[i]) || (literal[i] == '.' && !point)); i++) {
+        if (literal[i] == '.') {
+            point = true;
+            continue;
+        }
+        any_digits = true;
+        exponent -= point;
+        if (numerator.empty() && literal[i] == '0') {
             continue;
         }
+        multiply_add(numerator, 10, static_cast<uint32_t>(literal[i] - '0'));
+        significant_digits++;
+    }
+    if (!any_digits) {
+        return T{};
+    }
 
-        T a = std::get<T>(stack.top());
-        stack.pop();
-        T b = std::get<T>(stack.top());
-        stack.pop();
+    // an exponent only counts if it has digits
+    if (i < literal.size() && (literal[i] == 'e' || literal[i] == 'E')) {
+        size_t j = i + 1;
+        bool negative_exponent = j < literal.size() && literal[j] == '-';
+        j += j < literal.size() && (literal[j] == '-' || literal[j] == '+');
+        int64_t written_exponent = 0;
+        for (; j < literal.size() && is_digit(literal[j]); j++) {
+            written_exponent = std::min<int64_t>(written_exponent * 10 + (literal[j] - '0'), 100000);
+        }
+        exponent += negative_exponent ? -written_exponent : written_exponent;
+    }
 
-        switch (std::get<special_char>(current_token).value) {
-            case special_char::PLUS:
-                stack.push(b + a);
-                break;
-            case special_char::MINUS:
-                stack.push(b - a);
-                break;
-            case special_char::MULTIPLY:
-                stack.push(b * a);
-                break;
-            case special_char::DIVIDE:
-                stack.push(b / a);
-                break;
+    const T infinity = negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+    const T zero = negative ? -T(0) : T(0);
+    if (numerator.empty() || exponent + significant_digits < format::smallest_power_of_ten) {
+        return zero;
+    }
+    if (exponent + significant_digits - 1 > format::largest_power_of_ten) {
+        return infinity;
+    }
+
+    wide denominator{1};
+    for (int64_t k = 0; k < exponent; k++) {
+        multiply_add(numerator, 10, 0);
+    }
+    for (int64_t k = 0; k > exponent; k--) {
+        multiply_add(denominator, 10, 0);
+    }
+
+    // numerator / denominator / 2^shift has PRECISION + 1 or PRECISION + 2 bits, or fewer for a subnormal
+    int64_t shift = std::max(bit_length(numerator) - bit_length(denominator) - (PRECISION + 1), SMALLEST_SHIFT);
+    shift_left(shift < 0 ? numerator : denominator, shift < 0 ? -shift : shift);
+
+    uint64_t quotient = 0;
+    for (int bit = PRECISION + 1; bit >= 0; bit--) {
+        wide scaled = denominator;
+        shift_left(scaled, bit);
+        if (!less(numerator, scaled)) {
+            subtract(numerator, scaled);
+            quotient |= uint64_t(1) << bit;
         }
     }
+    bool sticky = !numerator.empty();
+    if (quotient >> (PRECISION + 1) != 0) {
+        sticky = sticky || (quotient & 1) != 0;
+        quotient >>= 1;
+        shift++;
+    }
+
+    // round to nearest, ties to even; the value is now mantissa * 2^(shift + 1)
+    uint64_t mantissa = quotient >> 1;
+    if ((quotient & 1) != 0 && (sticky || (mantissa & 1) != 0)) {
+        mantissa++;
+    }
+    if (mantissa >> PRECISION != 0) {
+        mantissa >>= 1;
+        shift++;
+    }
 
-    return std::get<T>(stack.top());
+    // the implicit bit of a normal mantissa carries into the exponent field, a subnormal has none
+    uint64_t biased = static_cast<uint64_t>(shift - SMALLEST_SHIFT);
+    if (biased + (mantissa >> format::mantissa_bits) >= static_cast<uint64_t>(format::infinite_power)) {
+        return infinity;
+    }
+    auto bits = static_cast<typename format::bits>((biased << format::mantissa_bits) + mantissa);
+    bits |= static_cast<typename format::bits>(negative) << (sizeof(bits) * 8 - 1);
+    return std::bit_cast<T>(bits);
 }
 
-// main loop
-int main() {
-    std::optional<token<float>> previous_result = std::nullopt;
+// whether a literal too far out of range for std::from_chars is too large rather than too small, which is when its
+// leading digit is in front of the decimal point once the written exponent is applied
+constexpr bool literal_overflows(std::string_view literal) {
+    size_t i = literal.starts_with('-') || literal.starts_with('+');
+    int64_t integer_digits = 0, fraction_zeros = 0;
+    bool point = false, leading = true;
+    for (; i < literal.size() && (is_digit(literal[i]) || literal[i] == '.'); i++) {
+        if (literal[i] == '.') {
+            point = true;
+        } else if (leading && literal[i] == '0') {
+            fraction_zeros += point;
+        } else {
+            leading = false;
+            integer_digits += !point;
+        }
+    }
 
-    while (true) {
-        std::string input;
-        std::cout << "> ";
-        if (previous_result.has_value()) {
-            std::cout << previous_result.value() << " ";
+    int64_t written_exponent = 0;
+    if (i < literal.size() && (literal[i] == 'e' || literal[i] == 'E')) {
+        bool negative_exponent = ++i < literal.size() && literal[i] == '-';
+        i += i < literal.size() && (literal[i] == '-' || literal[i] == '+');
+        for (; i < literal.size() && is_digit(literal[i]); i++) {
+            written_exponent = std::min<int64_t>(written_exponent * 10 + (literal[i] - '0'), 100000);
         }
+        written_exponent = negative_exponent ? -written_exponent : written_exponent;
+    }
+    return integer_digits - fraction_zeros + written_exponent > 0;
+}
 
-        std::getline(std::cin, input);
+// number literal conversion, done in place with std::from_chars for arithmetic types, after the Eisel-Lemire fast
+// path for float and double; out of range literals become infinity or zero, or the nearest limit for integers,
+// since std::from_chars leaves the value alone for them
+template <typename T>
+constexpr T parse_number(std::string_view literal) {
+    T value{};
 
-        input.erase(std::remove_if(input.begin(), input.end(), isspace), input.end());
+    if constexpr (std::is_arithmetic_v<T>) {
+        if (std::is_constant_evaluated()) {
+            if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+#if FAST_FLOAT_AVAILABLE
+                if (parse_float_fast(literal, value)) {
+                    return value;
+                }
+#endif
+                return parse_decimal_exact<T>(literal);
+            } else {
+                return parse_decimal<T>(literal);
+            }
+        }
+#if FAST_FLOAT_AVAILABLE
+        if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+            if (parse_float_fast(literal, value)) {
+                return value;
+            }
+        }
+#endif
+        if (std::from_chars(literal.data(), literal.data() + literal.size(), value).ec == std::errc::result_out_of_range) {
+            bool negative = literal.starts_with('-');
+            if constexpr (std::is_floating_point_v<T>) {
+                value = literal_overflows(literal) ? std::numeric_limits<T>::infinity() : T(0);
+                value = negative ? -value : value;
+            } else {
+                value = negative ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+            }
+        }
+    } else {
+        std::istringstream(std::string(literal)) >> value;
+    }
 
-        if (input == "") {
-            previous_result = std::nullopt;
-            continue;
+    return value;
+}
+
+// the constant-expression conversion overflows and rounds the same way
+static_assert(parse_number<float>("1e39") == std::numeric_limits<float>::infinity());
+static_assert(std::bit_cast<uint64_t>(parse_number<double>("90639042881.275946e26")) == 0x479b4693ef75dd97);
+
+// operators and parentheses, the only characters the tokenizer treats one at a time
+constexpr bool is_structural_char(char c) {
+    return c == '+' || c == '-' || c == '*' || c == '/' || c == '(' || c == ')';
+}
+
+// whether an input takes the previous result as its left operand, which is when it starts with an operator or a
+// parenthesis; an input that starts with a literal is a new expression, and its value replaces the previous result
+constexpr bool continues_previous_result(std::string_view expression) {
+    return expression.empty() || is_structural_char(expression[0]);
+}
+
+// bytes classified per structural mask
+const size_t STRUCTURAL_BLOCK = 64;
+
+// structural masks for count whole blocks, bit j of masks[k] is set when block k has a structural character at j
+using structural_scanner = void (*)(const char* data, size_t count, uint64_t* masks);
+
+inline void structural_masks_bytewise(const char* data, size_t count, uint64_t* masks) {
+    for (size_t block = 0; block < count; block++) {
+        uint64_t mask = 0;
+        for (size_t j = 0; j < STRUCTURAL_BLOCK; j++) {
+            mask |= static_cast<uint64_t>(is_structural_char(data[block * STRUCTURAL_BLOCK + j])) << j;
+        }
+        masks[block] = mask;
+    }
+}
+
+#if defined(__x86_64__)
+// the six structural characters are 0x28 to 0x2f except ',' and '.', so a byte is structural when its top five
+// bits are 00101 and its bits 2 and 0 are not 1 and 0; two masks and two comparisons per vector
+inline void structural_masks_sse2(const char* data, size_t count, uint64_t* masks) {
+    const __m128i high = _mm_set1_epi8(static_cast<char>(0xf8)), range = _mm_set1_epi8(0x28);
+    const __m128i low = _mm_set1_epi8(0x05), excluded = _mm_set1_epi8(0x04);
+    for (size_t block = 0; block < count; block++) {
+        uint64_t mask = 0;
+        for (size_t j = 0; j < STRUCTURAL_BLOCK; j += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + block * STRUCTURAL_BLOCK + j));
+            __m128i in_range = _mm_cmpeq_epi8(_mm_and_si128(bytes, high), range);
+            __m128i comma_or_dot = _mm_cmpeq_epi8(_mm_and_si128(bytes, low), excluded);
+            mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_andnot_si128(comma_or_dot, in_range)))) << j;
         }
+        masks[block] = mask;
+    }
+}
 
-        if (input == "help" || input == "h") {
-            std::cout << HELPMSG << "\n";
-            continue;
+__attribute__((target("avx2")))
+inline void structural_masks_avx2(const char* data, size_t count, uint64_t* masks) {
+    const __m256i high = _mm256_set1_epi8(static_cast<char>(0xf8)), range = _mm256_set1_epi8(0x28);
+    const __m256i low = _mm256_set1_epi8(0x05), excluded = _mm256_set1_epi8(0x04);
+    for (size_t block = 0; block < count; block++) {
+        uint64_t mask = 0;
+        for (size_t j = 0; j < STRUCTURAL_BLOCK; j += 32) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + block * STRUCTURAL_BLOCK + j));
+            __m256i in_range = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, high), range);
+            __m256i comma_or_dot = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, low), excluded);
+            mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_andnot_si256(comma_or_dot, in_range)))) << j;
         }
+        masks[block] = mask;
+    }
+}
+#endif
 
-        if (input == "quit" || input == "q") {
-            break;
+// widest classifier the processor supports, picked once
+inline structural_scanner structural_masks() {
+#if defined(__x86_64__)
+    static const structural_scanner best = __builtin_cpu_supports("avx2") ? structural_masks_avx2 : structural_masks_sse2;
+    return best;
+#else
+    return structural_masks_bytewise;
+#endif
+}
+
+// shorter inputs are scanned byte by byte, the masks only pay off once runs of literal characters get skipped
+const size_t STRUCTURAL_INDEX_MIN = 256;
+
+enum class scan_mode {
+    automatic,
+    bytewise,
+    indexed
+};
+
+// expression tokenizer, hands every token to emit as soon as it is complete; the only allocations it makes
+// are for new variable names, and without a variable table names are read as numbers, as before variables existed;
+// long inputs are indexed first, simdjson style: SIMD masks mark the structural characters of 64 bytes at a time,
+// and everything between two of them is taken as one literal run instead of character by character
+template <typename T, typename Sink>
+constexpr void tokenize(const std::optional<token<T>>& previous_result, std::string_view expression, Sink&& emit,
+                        variable_table* variables = nullptr, scan_mode mode = scan_mode::automatic) {
+    bool continued = previous_result.has_value() && continues_previous_result(expression);
+    if (continued) {
+        emit(previous_result.value());
+    }
+
+    char prev_char = continued ? '0' : '\0';
+
+    // the pending literal is always a contiguous slice of the input ending at the current character
+    size_t buffer_begin = 0, buffer_end = 0;
+    auto buffer_empty = [&]() { return buffer_begin == buffer_end; };
+    auto buffer_is_number = [&]() {
+        size_t first = buffer_begin + (expression[buffer_begin] == '-');
+        return first == buffer_end || !is_identifier_char(expression[first]);
+    };
+    auto flush_buffer = [&]() {
+        if (buffer_empty()) {
+            return;
+        }
+
+        std::string_view literal = expression.substr(buffer_begin, buffer_end - buffer_begin);
+        bool number = variables == nullptr || buffer_is_number();
+        buffer_begin = buffer_end;
+
+        if (number) {
+            emit(parse_number<T>(literal));
+            return;
+        }
+
+        // negated variable, expanded like a unary minus before a parenthesis
+        if (literal[0] == '-') {
+            literal.remove_prefix(1);
+            emit(parse_number<T>("-1"));
+            emit(special_char{special_char::MULTIPLY});
+        }
+
+        size_t index = std::find(variables->begin(), variables->end(), literal) - variables->begin();
+        if (index == variables->size()) {
+            variables->emplace_back(literal);
+        }
+        emit(variable{index});
+    };
+
+    // a run of characters that are not structural extends the pending literal
+    auto literal_run = [&](size_t begin, size_t end) {
+        if (prev_char == ')') {
+            emit(special_char{special_char::MULTIPLY});
         }
+        if (buffer_empty()) {
+            buffer_begin = begin;
+        }
+        buffer_end = end;
+        prev_char = expression[end - 1];
+    };
 
-        std::vector<token<float>> tokens = parse<float>(previous_result, input);
+    auto structural = [&](size_t i) {
+        char new_char = expression[i];
 
-        // print tokens
-        // for (const auto& token : tokens) {
-        //     std::cout << token << "\n";
-        // }
+        switch (new_char) {
+            case '-':
+            case '+':
+                // sign of an exponent inside a number literal
+                if ((prev_char == 'e' || prev_char == 'E') && !buffer_empty() && buffer_is_number()) {
+                    buffer_end = i + 1;
+                    break;
+                }
+
+                if (new_char == '+') {
+                    flush_buffer();
+                    emit(special_char{special_char::PLUS});
+                    break;
+                }
+
+                // handle unary minus check
+                if (!is_digit(prev_char) && !(variables != nullptr && is_identifier_char(prev_char)) && prev_char != ')') {
+                    if (!buffer_empty()) {
+                        buffer_begin = buffer_end = i + 1;
+                        break;
+                    }
+                    buffer_begin = i;
+                    buffer_end = i + 1;
+                    break;
+                }
+                [[fallthrough]];
+            case '*':
+            case '/':
+            case ')':
+                flush_buffer();
+                emit(special_char{static_cast<special_char::type>(new_char)});
+                break;
+            case '(':
+                if (prev_char == ')') {
+                    emit(special_char{special_char::MULTIPLY});
+                    prev_char = '*';
+                }
+
+                // after a '-' the pending literal is a lone unary minus, or a number ending in the sign of an empty
+                // exponent; that number is emitted as it is, with no operator before the parenthesis, so the
+                // expression is malformed
+                if (prev_char == '-' && buffer_end - buffer_begin == 1) {
+                    emit(parse_number<T>("-1"));
+                    buffer_begin = buffer_end;
+                    emit(special_char{special_char::MULTIPLY});
+                    prev_char = '*';
+                }
+
+                flush_buffer();
+
+                if (prev_char != '(' && prev_char != '+' && prev_char != '-' && prev_char != '*' && prev_char != '/' && prev_char != '\0') {
+                    emit(special_char{special_char::MULTIPLY});
+                    prev_char = '*';
+                }
+
+                emit(special_char{static_cast<special_char::type>(new_char)});
+                break;
+            default:
+                break;
+        }
+
+        prev_char = new_char;
+    };
+
+    if (mode == scan_mode::automatic) {
+        mode = expression.size() >= STRUCTURAL_INDEX_MIN ? scan_mode::indexed : scan_mode::bytewise;
+    }
+
+    if (std::is_constant_evaluated() || mode == scan_mode::bytewise) {
+        for (size_t i = 0; i < expression.size(); i++) {
+            if (is_structural_char(expression[i])) {
+                structural(i);
+            } else {
+                literal_run(i, i + 1);
+            }
+        }
+        flush_buffer();
+        return;
+    }
+
+    // masks for a few kilobytes at a time, the tail goes through a zero-padded copy of its last block
+    const size_t CHUNK_BLOCKS = 64;
+    uint64_t masks[CHUNK_BLOCKS];
+    structural_scanner scanner = structural_masks();
+    size_t run_begin = 0;
+    for (size_t chunk = 0; chunk < expression.size(); chunk += CHUNK_BLOCKS * STRUCTURAL_BLOCK) {
+        size_t bytes = std::min(CHUNK_BLOCKS * STRUCTURAL_BLOCK, expression.size() - chunk);
+        size_t whole = bytes / STRUCTURAL_BLOCK;
+        scanner(expression.data() + chunk, whole, masks);
+        if (bytes % STRUCTURAL_BLOCK != 0) {
+            char tail[STRUCTURAL_BLOCK] = {};
+            std::copy(expression.begin() + chunk + whole * STRUCTURAL_BLOCK, expression.begin() + chunk + bytes, tail);
+            scanner(tail, 1, masks + whole);
+            whole++;
+        }
+
+        for (size_t block = 0; block < whole; block++) {
+            for (uint64_t mask = masks[block]; mask != 0; mask &= mask - 1) {
+                size_t i = chunk + block * STRUCTURAL_BLOCK + std::countr_zero(mask);
+                if (i > run_begin) {
+                    literal_run(run_begin, i);
+                }
+                structural(i);
+                run_begin = i + 1;
+            }
+        }
+    }
+    if (run_begin < expression.size()) {
+        literal_run(run_begin, expression.size());
+    }
+
+    flush_buffer();
+}
+
+// expression parser, the only allocations it makes are for the output tokens and new variable names
+template <typename T>
+constexpr void parse(const std::optional<token<T>>& previous_result, std::string_view expression, std::vector<token<T>>& tokens,
+                     variable_table* variables = nullptr) {
+    tokens.clear();
+    tokenize<T>(previous_result, expression, [&](const token<T>& current_token) { tokens.push_back(current_token); }, variables);
+}
+
+template <typename T>
+constexpr std::vector<token<T>> parse(const std::optional<token<T>>& previous_result, std::string_view expression,
+                            variable_table* variables = nullptr) {
+    std::vector<token<T>> tokens;
+    parse(previous_result, expression, tokens, variables);
+    return tokens;
+}
+
+// three-prime number-theoretic transforms recombine coefficients of up to 86 bits in 128-bit arithmetic
+#if defined(__SIZEOF_INT128__)
+#define NTT_MULTIPLY_AVAILABLE 1
+#else
+#define NTT_MULTIPLY_AVAILABLE 0
+#endif
+
+// multiplication algorithm of a big_integer product; automatic picks by the length of the shorter operand, and
+// the parts of a product are always multiplied automatically
+enum class multiplication {
+    automatic,
+    schoolbook,
+    karatsuba,
+    toom3,
+    ntt
+};
+
+// shorter operand lengths, in 32-bit limbs, from which each multiplication algorithm takes over
+const size_t KARATSUBA_THRESHOLD = 32;
+const size_t TOOM3_THRESHOLD = 128;
+const size_t NTT_THRESHOLD = 4096;
+
+// divisors and quotients shorter than this many limbs are divided by schoolbook long division
+const size_t NEWTON_THRESHOLD = 2048;
+
+// numbers shorter than this many limbs are converted to and from decimal 9 digits at a time
+const size_t DECIMAL_THRESHOLD = 32;
+
+// arbitrary-precision signed integer usable as T: + - * / with / truncating toward zero, as for the built-in
+// integers, and a quotient by zero is nan, which every later operation carries, the way an infinity or NaN does for
+// float; magnitudes are little-endian 32-bit limbs, multiplied by schoolbook, Karatsuba, Toom-3 or a three-prime NTT
+// depending on the length of the shorter operand, and divided by long division or, once both the divisor and the
+// quotient are long, through a Newton reciprocal; decimal conversion splits at powers 10^(9*2^k) both ways
+class big_integer {
+public:
+
+    big_integer() = default;
+
+    big_integer(long long value) : negative(value < 0) {
+        unsigned long long magnitude_value = value < 0 ? 0ull - static_cast<unsigned long long>(value) : value;
+        for (; magnitude_value != 0; magnitude_value >>= 32) {
+            magnitude.push_back(static_cast<uint32_t>(magnitude_value));
+        }
+    }
+
+    // decimal digits with an optional sign; nan for anything else
+    static big_integer from_string(std::string_view text) {
+        big_integer value;
+        bool sign = !text.empty() && (text[0] == '-' || text[0] == '+');
+        std::string_view digits = text.substr(sign);
+        if (digits.empty() || !std::all_of(digits.begin(), digits.end(), is_digit)) {
+            value.undefined = true;
+            return value;
+        }
+        value.magnitude = parse_decimal(digits, decimal_powers(digits.size()));
+        value.negative = text[0] == '-' && !value.magnitude.empty();
+        return value;
+    }
+
+    std::string to_string() const {
+        if (undefined) {
+            return "nan";
+        }
+        if (magnitude.empty()) {
+            return "0";
+        }
+        std::string text = negative ? "-" : "";
+        std::vector<limbs> powers = decimal_powers(magnitude.size() * 32 * 30103 / 100000 + 1);
+        std::vector<limbs> inverses(powers.size());
+        append_decimal(text, magnitude, 0, powers, inverses, powers.size() - 1);
+        return text;
+    }
+
+    bool is_nan() const {
+        return undefined;
+    }
+
+    // significant bits of the magnitude
+    size_t bits() const {
+        return magnitude.empty() ? 0 : magnitude.size() * 32 - std::countl_zero(magnitude.back());
+    }
+
+    // product by a chosen algorithm, for comparing them
+    static big_integer multiply(const big_integer& lhs, const big_integer& rhs, multiplication method) {
+        if (lhs.undefined || rhs.undefined) {
+            return nan();
+        }
+        const limbs& a = lhs.magnitude;
+        const limbs& b = rhs.magnitude;
+        big_integer product;
+        switch (method) {
+            case multiplication::automatic:
+                product.magnitude = multiply(a, b);
+                break;
+            case multiplication::schoolbook:
+                product.magnitude = multiply_schoolbook(a, b);
+                break;
+            case multiplication::karatsuba:
+                product.magnitude = a.empty() || b.empty() ? limbs() : multiply_karatsuba(a, b);
+                break;
+            case multiplication::toom3:
+                product.magnitude = a.empty() || b.empty() ? limbs() : multiply_toom3(a, b);
+                break;
+            case multiplication::ntt:
+#if NTT_MULTIPLY_AVAILABLE
+                product.magnitude = a.empty() || b.empty() || a.size() + b.size() > NTT_MAX_LENGTH ? multiply(a, b)
+                                                                                                   : multiply_ntt(a, b);
+#else
+                product.magnitude = multiply(a, b);
+#endif
+                break;
+        }
+        product.negative = lhs.negative != rhs.negative && !product.magnitude.empty();
+        return product;
+    }
+
+    big_integer operator-() const {
+        big_integer negated = *this;
+        negated.negative = !negated.negative && !negated.magnitude.empty();
+        return negated;
+    }
+
+    friend big_integer operator+(const big_integer& lhs, const big_integer& rhs) {
+        if (lhs.undefined || rhs.undefined) {
+            return nan();
+        }
+        big_integer sum;
+        if (lhs.negative == rhs.negative) {
+            sum.magnitude = add(lhs.magnitude, rhs.magnitude);
+            sum.negative = lhs.negative;
+        } else if (compare(lhs.magnitude, rhs.magnitude) >= 0) {
+            sum.magnitude = subtract(lhs.magnitude, rhs.magnitude);
+            sum.negative = lhs.negative && !sum.magnitude.empty();
+        } else {
+            sum.magnitude = subtract(rhs.magnitude, lhs.magnitude);
+            sum.negative = rhs.negative;
+        }
+        return sum;
+    }
+
+    friend big_integer operator-(const big_integer& lhs, const big_integer& rhs) {
+        return lhs + -rhs;
+    }
+
+    friend big_integer operator*(const big_integer& lhs, const big_integer& rhs) {
+        return multiply(lhs, rhs, multiplication::automatic);
+    }
+
+    friend big_integer operator/(const big_integer& lhs, const big_integer& rhs) {
+        if (lhs.undefined || rhs.undefined || rhs.magnitude.empty()) {
+            return nan();
+        }
+        big_integer quotient;
+        quotient.magnitude = divide(lhs.magnitude, rhs.magnitude).first;
+        quotient.negative = lhs.negative != rhs.negative && !quotient.magnitude.empty();
+        return quotient;
+    }
+
+    // nan equals nothing, itself included
+    friend bool operator==(const big_integer& lhs, const big_integer& rhs) {
+        return !lhs.undefined && !rhs.undefined && lhs.negative == rhs.negative && lhs.magnitude == rhs.magnitude;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const big_integer& value) {
+        return out << value.to_string();
+    }
+
+    // reads a sign and the digits after it, and stops at the first other character, like from_chars for integers
+    friend std::istream& operator>>(std::istream& in, big_integer& value) {
+        std::string text;
+        in >> std::ws;
+        if (in.peek() == '-' || in.peek() == '+') {
+            text += static_cast<char>(in.get());
+        }
+        while (isdigit(in.peek())) {
+            text += static_cast<char>(in.get());
+        }
+        if (text.empty() || !is_digit(text.back())) {
+            in.setstate(std::ios::failbit);
+            return in;
+        }
+        value = from_string(text);
+        return in;
+    }
+
+private:
+
+    using limbs = std::vector<uint32_t>;
+
+    limbs magnitude;
+    bool negative = false;
+    bool undefined = false;
+
+    static big_integer nan() {
+        big_integer value;
+        value.undefined = true;
+        return value;
+    }
+
+    static void trim(limbs& a) {
+        while (!a.empty() && a.back() == 0) {
+            a.pop_back();
+        }
+    }
+
+    static int compare(const limbs& a, const limbs& b) {
+        if (a.size() != b.size()) {
+            return a.size() < b.size() ? -1 : 1;
+        }
+        for (size_t i = a.size(); i-- > 0;) {
+            if (a[i] != b[i]) {
+                return a[i] < b[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    static limbs add(const limbs& a, const limbs& b) {
+        limbs sum = a.size() >= b.size() ? a : b;
+        add_shifted(sum, a.size() >= b.size() ? b : a, 0);
+        return sum;
+    }
+
+    // a += b * 2^(32 * shift)
+    static void add_shifted(limbs& a, const limbs& b, size_t shift) {
+        if (a.size() < b.size() + shift) {
+            a.resize(b.size() + shift);
+        }
+        uint64_t carry = 0;
+        for (size_t i = 0; i < b.size(); i++) {
+            carry += static_cast<uint64_t>(a[i + shift]) + b[i];
+            a[i + shift] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        for (size_t i = b.size() + shift; carry != 0; i++) {
+            if (i == a.size()) {
+                a.push_back(0);
+            }
+            carry += a[i];
+            a[i] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+    }
+
+    // a - b for a >= b
+    static limbs subtract(const limbs& a, const limbs& b) {
+        limbs difference = a;
+        int64_t borrow = 0;
+        for (size_t i = 0; i < a.size() && (i < b.size() || borrow != 0); i++) {
+            int64_t current = static_cast<int64_t>(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+            borrow = current < 0;
+            difference[i] = static_cast<uint32_t>(current);
+        }
+        trim(difference);
+        return difference;
+    }
+
+    static limbs slice(const limbs& a, size_t begin, size_t end) {
+        begin = std::min(begin, a.size());
+        limbs part(a.begin() + begin, a.begin() + std::max(begin, std::min(end, a.size())));
+        trim(part);
+        return part;
+    }
+
+    static limbs shift_left(const limbs& a, size_t bits) {
+        if (a.empty()) {
+            return a;
+        }
+        size_t whole = bits / 32, rest = bits % 32;
+        limbs shifted(a.size() + whole + 1);
+        for (size_t i = 0; i < a.size(); i++) {
+            uint64_t moved = static_cast<uint64_t>(a[i]) << rest;
+            shifted[i + whole] |= static_cast<uint32_t>(moved);
+            shifted[i + whole + 1] = static_cast<uint32_t>(moved >> 32);
+        }
+        trim(shifted);
+        return shifted;
+    }
+
+    static limbs shift_right(const limbs& a, size_t bits) {
+        size_t whole = bits / 32, rest = bits % 32;
+        if (whole >= a.size()) {
+            return {};
+        }
+        limbs shifted(a.size() - whole);
+        for (size_t i = 0; i < shifted.size(); i++) {
+            uint64_t window = a[i + whole] | (i + whole + 1 < a.size() ? static_cast<uint64_t>(a[i + whole + 1]) << 32 : 0);
+            shifted[i] = static_cast<uint32_t>(window >> rest);
+        }
+        trim(shifted);
+        return shifted;
+    }
+
+    // a * factor + addend
+    static void multiply_add_small(limbs& a, uint32_t factor, uint32_t addend) {
+        uint64_t carry = addend;
+        for (uint32_t& limb : a) {
+            carry += static_cast<uint64_t>(limb) * factor;
+            limb = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        if (carry != 0) {
+            a.push_back(static_cast<uint32_t>(carry));
+        }
+    }
+
+    // a / divisor, the remainder is left in remainder
+    static limbs divide_small(const limbs& a, uint32_t divisor, uint32_t& remainder) {
+        limbs quotient(a.size());
+        uint64_t rest = 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            rest = rest << 32 | a[i];
+            quotient[i] = static_cast<uint32_t>(rest / divisor);
+            rest %= divisor;
+        }
+        remainder = static_cast<uint32_t>(rest);
+        trim(quotient);
+        return quotient;
+    }
+
+    static limbs multiply(const limbs& a, const limbs& b) {
+        const limbs& shorter = a.size() <= b.size() ? a : b;
+        const limbs& longer = a.size() <= b.size() ? b : a;
+        if (shorter.empty()) {
+            return {};
+        }
+        if (shorter.size() < KARATSUBA_THRESHOLD) {
+            return multiply_schoolbook(a, b);
+        }
+#if NTT_MULTIPLY_AVAILABLE
+        if (shorter.size() >= NTT_THRESHOLD && a.size() + b.size() <= NTT_MAX_LENGTH) {
+            return multiply_ntt(a, b);
+        }
+#endif
+
+        // a much longer operand is cut into pieces as long as the shorter one
+        if (2 * shorter.size() < longer.size()) {
+            limbs product;
+            for (size_t begin = 0; begin < longer.size(); begin += shorter.size()) {
+                add_shifted(product, multiply(slice(longer, begin, begin + shorter.size()), shorter), begin);
+            }
+            trim(product);
+            return product;
+        }
+        return shorter.size() < TOOM3_THRESHOLD ? multiply_karatsuba(a, b) : multiply_toom3(a, b);
+    }
+
+    static limbs multiply_schoolbook(const limbs& a, const limbs& b) {
+        limbs product(a.size() + b.size());
+        for (size_t i = 0; i < a.size(); i++) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < b.size(); j++) {
+                carry += static_cast<uint64_t>(a[i]) * b[j] + product[i + j];
+                product[i + j] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            product[i + b.size()] = static_cast<uint32_t>(carry);
+        }
+        trim(product);
+        return product;
+    }
+
+    // (a1 x + a0)(b1 x + b0) from the three products a0 b0, a1 b1 and (a0 + a1)(b0 + b1)
+    static limbs multiply_karatsuba(const limbs& a, const limbs& b) {
+        size_t half = (std::max(a.size(), b.size()) + 1) / 2;
+        limbs a0 = slice(a, 0, half), a1 = slice(a, half, a.size());
+        limbs b0 = slice(b, 0, half), b1 = slice(b, half, b.size());
+
+        limbs low = multiply(a0, b0), high = multiply(a1, b1);
+        limbs middle = subtract(subtract(multiply(add(a0, a1), add(b0, b1)), low), high);
+
+        limbs product = low;
+        add_shifted(product, middle, half);
+        add_shifted(product, high, 2 * half);
+        trim(product);
+        return product;
+    }
+
+    // three-way split evaluated at 0, 1, -1, -2 and infinity, interpolated with Bodrato's sequence; the
+    // intermediate values can be negative, so they are big_integers
+    static limbs multiply_toom3(const limbs& a, const limbs& b) {
+        size_t third = (std::max(a.size(), b.size()) + 2) / 3;
+        auto part = [&](const limbs& x, size_t k) {
+            big_integer value;
+            value.magnitude = slice(x, k * third, (k + 1) * third);
+            return value;
+        };
+        big_integer a0 = part(a, 0), a1 = part(a, 1), a2 = part(a, 2);
+        big_integer b0 = part(b, 0), b1 = part(b, 1), b2 = part(b, 2);
+
+        big_integer a02 = a0 + a2, b02 = b0 + b2;
+        big_integer a_minus1 = a02 - a1, b_minus1 = b02 - b1;
+        big_integer a_minus2 = a_minus1 + a2, b_minus2 = b_minus1 + b2;
+        a_minus2 = a_minus2 + a_minus2 - a0;
+        b_minus2 = b_minus2 + b_minus2 - b0;
+
+        big_integer at0 = a0 * b0, at1 = (a02 + a1) * (b02 + b1), at_minus1 = a_minus1 * b_minus1;
+        big_integer at_minus2 = a_minus2 * b_minus2, at_infinity = a2 * b2;
+
+        big_integer c3 = exact_quotient(at_minus2 - at1, 3);
+        big_integer c1 = exact_quotient(at1 - at_minus1, 2);
+        big_integer c2 = at_minus1 - at0;
+        c3 = exact_quotient(c2 - c3, 2) + at_infinity + at_infinity;
+        c2 = c2 + c1 - at_infinity;
+        c1 = c1 - c3;
+
+        // the coefficients of the product polynomial are sums of products of parts, so none is negative
+        limbs product = at0.magnitude;
+        add_shifted(product, c1.magnitude, third);
+        add_shifted(product, c2.magnitude, 2 * third);
+        add_shifted(product, c3.magnitude, 3 * third);
+        add_shifted(product, at_infinity.magnitude, 4 * third);
+        trim(product);
+        return product;
+    }
+
+    static big_integer exact_quotient(const big_integer& value, uint32_t divisor) {
+        big_integer quotient = value;
+        uint32_t remainder = 0;
+        quotient.magnitude = divide_small(value.magnitude, divisor, remainder);
+        return quotient;
+    }
+
+#if NTT_MULTIPLY_AVAILABLE
+    // primes p = c * 2^k + 1 with primitive root 3; the first bounds the transform length at 2^23, and with
+    // operands of at most 2^22 limbs every coefficient, below 2^22 * 2^64, is under the product of the three
+    static constexpr uint32_t NTT_PRIMES[3] = {998244353, 167772161, 469762049};
+    static constexpr size_t NTT_MAX_LENGTH = size_t(1) << 23;
+
+    template <uint32_t P>
+    static uint32_t power_mod(uint64_t base, uint64_t exponent) {
+        uint64_t result = 1;
+        for (base %= P; exponent != 0; exponent >>= 1) {
+            if (exponent & 1) {
+                result = result * base % P;
+            }
+            base = base * base % P;
+        }
+        return static_cast<uint32_t>(result);
+    }
+
+    // in-place iterative transform of a power-of-two length
+    template <uint32_t P>
+    static void transform(std::vector<uint32_t>& a, bool inverse) {
+        size_t n = a.size();
+        for (size_t i = 1, j = 0; i < n; i++) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+            j ^= bit;
+            if (i < j) {
+                std::swap(a[i], a[j]);
+            }
+        }
+
+        std::vector<uint32_t> roots;
+        for (size_t length = 2; length <= n; length <<= 1) {
+            uint32_t root = power_mod<P>(3, (P - 1) / length);
+            if (inverse) {
+                root = power_mod<P>(root, P - 2);
+            }
+            roots.assign(length / 2, 1);
+            for (size_t i = 1; i < length / 2; i++) {
+                roots[i] = static_cast<uint32_t>(static_cast<uint64_t>(roots[i - 1]) * root % P);
+            }
+            for (size_t begin = 0; begin < n; begin += length) {
+                for (size_t i = 0; i < length / 2; i++) {
+                    uint32_t u = a[begin + i];
+                    uint32_t v = static_cast<uint32_t>(static_cast<uint64_t>(a[begin + i + length / 2]) * roots[i] % P);
+                    a[begin + i] = u + v >= P ? u + v - P : u + v;
+                    a[begin + i + length / 2] = u >= v ? u - v : u + P - v;
+                }
+            }
+        }
+
+        if (inverse) {
+            uint64_t scale = power_mod<P>(n, P - 2);
+            for (uint32_t& value : a) {
+                value = static_cast<uint32_t>(value * scale % P);
+            }
+        }
+    }
+
+    // cyclic convolution of the limbs modulo P, n is at least the length of the product
+    template <uint32_t P>
+    static std::vector<uint32_t> convolve(const limbs& a, const limbs& b, size_t n) {
+        std::vector<uint32_t> fa(n), fb(n);
+        for (size_t i = 0; i < a.size(); i++) {
+            fa[i] = a[i] % P;
+        }
+        for (size_t i = 0; i < b.size(); i++) {
+            fb[i] = b[i] % P;
+        }
+        transform<P>(fa, false);
+        transform<P>(fb, false);
+        for (size_t i = 0; i < n; i++) {
+            fa[i] = static_cast<uint32_t>(static_cast<uint64_t>(fa[i]) * fb[i] % P);
+        }
+        transform<P>(fa, true);
+        return fa;
+    }
+
+    // every coefficient is recovered from its three residues by Garner's algorithm, then carried into limbs
+    static limbs multiply_ntt(const limbs& a, const limbs& b) {
+        constexpr uint64_t P0 = NTT_PRIMES[0], P1 = NTT_PRIMES[1], P2 = NTT_PRIMES[2];
+        size_t n = std::bit_ceil(a.size() + b.size() - 1);
+        std::vector<uint32_t> r0 = convolve<NTT_PRIMES[0]>(a, b, n);
+        std::vector<uint32_t> r1 = convolve<NTT_PRIMES[1]>(a, b, n);
+        std::vector<uint32_t> r2 = convolve<NTT_PRIMES[2]>(a, b, n);
+
+        const uint64_t inverse_p0 = power_mod<NTT_PRIMES[1]>(P0, P1 - 2);
+        const uint64_t inverse_p0p1 = power_mod<NTT_PRIMES[2]>(P0 * P1 % P2, P2 - 2);
+        limbs product(a.size() + b.size());
+        unsigned __int128 carry = 0;
+        for (size_t i = 0; i < product.size(); i++) {
+            if (i < n) {
+                uint64_t v0 = r0[i];
+                uint64_t v1 = (r1[i] + P1 - v0 % P1) % P1 * inverse_p0 % P1;
+                uint64_t v2 = (r2[i] + P2 - (v0 + v1 * P0) % P2) % P2 * inverse_p0p1 % P2;
+                carry += v0 + v1 * P0 + static_cast<unsigned __int128>(v2) * (P0 * P1);
+            }
+            product[i] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        trim(product);
+        return product;
+    }
+#endif
+
+    // quotient and remainder of magnitudes, b not zero; inverse, when given, is the scaled_reciprocal of b
+    static std::pair<limbs, limbs> divide(const limbs& a, const limbs& b, const limbs* inverse = nullptr) {
+        if (compare(a, b) < 0) {
+            return {limbs(), a};
+        }
+        if (b.size() == 1) {
+            uint32_t remainder = 0;
+            limbs quotient = divide_small(a, b[0], remainder);
+            return {quotient, remainder == 0 ? limbs() : limbs{remainder}};
+        }
+        if (b.size() < NEWTON_THRESHOLD || a.size() - b.size() < NEWTON_THRESHOLD) {
+            return divide_schoolbook(a, b);
+        }
+        return divide_newton(a, b, inverse);
+    }
+
+    // Knuth's algorithm D: the divisor is shifted until its top bit is set, then every quotient limb is estimated
+    // from the top two limbs of the remainder and corrected at most twice
+    static std::pair<limbs, limbs> divide_schoolbook(const limbs& a, const limbs& b) {
+        int shift = std::countl_zero(b.back());
+        limbs u = shift_left(a, shift), v = shift_left(b, shift);
+        u.resize(a.size() + 1);
+        size_t n = v.size(), m = a.size() - n;
+        limbs quotient(m + 1);
+
+        for (size_t j = m + 1; j-- > 0;) {
+            uint64_t numerator = static_cast<uint64_t>(u[j + n]) << 32 | u[j + n - 1];
+            uint64_t estimate = numerator / v[n - 1], rest = numerator % v[n - 1];
+            while (estimate >> 32 != 0 || estimate * v[n - 2] > (rest << 32 | u[j + n - 2])) {
+                estimate--;
+                rest += v[n - 1];
+                if (rest >> 32 != 0) {
+                    break;
+                }
+            }
+
+            int64_t borrow = 0;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t product = estimate * v[i] + carry;
+                carry = product >> 32;
+                int64_t current = static_cast<int64_t>(u[i + j]) - borrow - static_cast<uint32_t>(product);
+                u[i + j] = static_cast<uint32_t>(current);
+                borrow = current < 0;
+            }
+            int64_t top = static_cast<int64_t>(u[j + n]) - borrow - static_cast<int64_t>(carry);
+            u[j + n] = static_cast<uint32_t>(top);
+
+            // the estimate was one too large
+            if (top < 0) {
+                estimate--;
+                carry = 0;
+                for (size_t i = 0; i < n; i++) {
+                    carry += static_cast<uint64_t>(u[i + j]) + v[i];
+                    u[i + j] = static_cast<uint32_t>(carry);
+                    carry >>= 32;
+                }
+                u[j + n] += static_cast<uint32_t>(carry);
+            }
+            quotient[j] = static_cast<uint32_t>(estimate);
+        }
+
+        trim(quotient);
+        u.resize(n);
+        return {quotient, shift_right(u, shift)};
+    }
+
+    // about 2^(64 n) / d for d of n limbs: the reciprocal of the top half of d, scaled, is refined by one Newton
+    // step x + x (2^(64 n) - d x) / 2^(64 n), which doubles the number of correct limbs
+    static limbs reciprocal(const limbs& d) {
+        size_t n = d.size();
+        if (n <= NEWTON_THRESHOLD) {
+            limbs power(2 * n + 1);
+            power.back() = 1;
+            return divide_schoolbook(power, d).first;
+        }
+
+        size_t k = (n + 1) / 2 + 1;
+        limbs x = reciprocal(slice(d, n - k, n));
+        x.insert(x.begin(), n - k, 0);
+
+        limbs power(2 * n + 1);
+        power.back() = 1;
+        limbs product = multiply(d, x);
+        if (compare(power, product) >= 0) {
+            return add(x, shift_right(multiply(x, subtract(power, product)), 64 * n));
+        }
+        return subtract(x, shift_right(multiply(x, subtract(product, power)), 64 * n));
+    }
+
+    // about 2^(32 (2 n + 2)) / b for b of n limbs, precise enough for any quotient of at most n + 1 limbs, so a
+    // divisor used many times needs it only once
+    static limbs scaled_reciprocal(const limbs& b) {
+        return reciprocal(shift_left(b, 64));
+    }
+
+    // the operands are truncated, or scaled, to a divisor one limb longer than the quotient, the quotient is
+    // estimated from its reciprocal, and the exact remainder corrects the last few units; a scaled_reciprocal
+    // of b stands in for the reciprocal of every such divisor, shifted to its length
+    static std::pair<limbs, limbs> divide_newton(const limbs& a, const limbs& b, const limbs* inverse = nullptr) {
+        size_t n = a.size() - b.size() + 2;
+        limbs numerator = n >= b.size() ? shift_left(a, 32 * (n - b.size())) : shift_right(a, 32 * (b.size() - n));
+        limbs x;
+        if (inverse != nullptr && n <= b.size() + 2) {
+            x = shift_right(*inverse, 32 * (b.size() + 2 - n));
+        } else {
+            x = reciprocal(n >= b.size() ? shift_left(b, 32 * (n - b.size())) : shift_right(b, 32 * (b.size() - n)));
+        }
+
+        limbs quotient = shift_right(multiply(numerator, x), 64 * n);
+        limbs product = multiply(quotient, b);
+        while (compare(product, a) > 0) {
+            quotient = subtract(quotient, {1});
+            product = subtract(product, b);
+        }
+        limbs remainder = subtract(a, product);
+        while (compare(remainder, b) >= 0) {
+            quotient = add(quotient, {1});
+            remainder = subtract(remainder, b);
+        }
+        return {quotient, remainder};
+    }
+
+    // powers[k] is 10^(9 * 2^k), up to the largest with at most digits digits
+    static std::vector<limbs> decimal_powers(size_t digits) {
+        std::vector<limbs> powers = {{1000000000}};
+        for (size_t width = 18; width <= digits; width *= 2) {
+            powers.push_back(multiply(powers.back(), powers.back()));
+        }
+        return powers;
+    }
+
+    static limbs parse_decimal(std::string_view digits, const std::vector<limbs>& powers) {
+        if (digits.size() <= 9 * DECIMAL_THRESHOLD) {
+            limbs value;
+            size_t group = digits.size() % 9 == 0 ? 9 : digits.size() % 9;
+            for (size_t begin = 0; begin < digits.size(); begin += group, group = 9) {
+                uint32_t chunk = 0, scale = 1;
+                for (size_t i = begin; i < begin + group; i++) {
+                    chunk = chunk * 10 + (digits[i] - '0');
+                    scale *= 10;
+                }
+                multiply_add_small(value, scale, chunk);
+            }
+            trim(value);
+            return value;
+        }
+
+        // the low part is the largest power-of-two number of 9-digit groups that leaves some digits above it
+        size_t level = 0;
+        while (level + 1 < powers.size() && 9 * (size_t(2) << level) < digits.size()) {
+            level++;
+        }
+        size_t low = 9 * (size_t(1) << level);
+        limbs value = multiply(parse_decimal(digits.substr(0, digits.size() - low), powers), powers[level]);
+        add_shifted(value, parse_decimal(digits.substr(digits.size() - low), powers), 0);
+        trim(value);
+        return value;
+    }
+
+    // decimal digits of a < powers[level]^2, with leading zeros up to width when width is not 0; the reciprocal of
+    // each power is computed the first time a division by it is long enough to go through one
+    static void append_decimal(std::string& out, const limbs& a, size_t width, const std::vector<limbs>& powers,
+                               std::vector<limbs>& inverses, size_t level) {
+        if (a.size() <= DECIMAL_THRESHOLD) {
+            std::string digits;
+            limbs rest = a;
+            while (!rest.empty()) {
+                uint32_t chunk = 0;
+                rest = divide_small(rest, 1000000000, chunk);
+                for (int i = 0; i < 9 && (chunk != 0 || !rest.empty()); i++, chunk /= 10) {
+                    digits += static_cast<char>('0' + chunk % 10);
+                }
+            }
+            if (digits.size() < width) {
+                digits.append(width - digits.size(), '0');
+            }
+            out.append(digits.rbegin(), digits.rend());
+            return;
+        }
+
+        const limbs& power = powers[level];
+        if (power.size() >= NEWTON_THRESHOLD && inverses[level].empty()) {
+            inverses[level] = scaled_reciprocal(power);
+        }
+        size_t low = 9 * (size_t(1) << level);
+        auto [high, rest] = divide(a, power, inverses[level].empty() ? nullptr : &inverses[level]);
+        if (high.empty()) {
+            append_decimal(out, rest, width, powers, inverses, level - 1);
+            return;
+        }
+        append_decimal(out, high, width > low ? width - low : 0, powers, inverses, level - 1);
+        append_decimal(out, rest, low, powers, inverses, level - 1);
+    }
+};
+
+// binary operator semantics shared by every evaluator
+template <typename T>
+constexpr T apply_operator(special_char::type op, const T& lhs, const T& rhs) {
+    switch (op) {
+        case special_char::PLUS:
+            return lhs + rhs;
+        case special_char::MINUS:
+            return lhs - rhs;
+        case special_char::MULTIPLY:
+            return lhs * rhs;
+        case special_char::DIVIDE:
+            return lhs / rhs;
+        default:
+            return lhs;
+    }
+}
+
+// one byte per postfix token; operands come from the constant pool or the variable slot list, in program order
+enum class opcode : uint8_t {
+    CONSTANT,
+    VARIABLE,
+    PLUS,
+    MINUS,
+    MULTIPLY,
+    DIVIDE
+};
+
+constexpr opcode opcode_of(special_char::type op) {
+    switch (op) {
+        case special_char::PLUS:
+            return opcode::PLUS;
+        case special_char::MINUS:
+            return opcode::MINUS;
+        case special_char::MULTIPLY:
+            return opcode::MULTIPLY;
+        default:
+            return opcode::DIVIDE;
+    }
+}
+
+constexpr special_char::type operator_of(opcode op) {
+    switch (op) {
+        case opcode::PLUS:
+            return special_char::PLUS;
+        case opcode::MINUS:
+            return special_char::MINUS;
+        case opcode::MULTIPLY:
+            return special_char::MULTIPLY;
+        default:
+            return special_char::DIVIDE;
+    }
+}
+
+// postfix program compiled once from a token sequence, then evaluated any number of times
+template <typename T>
+class compiled_expression {
+public:
+
+    constexpr compiled_expression(const std::vector<token<T>>& expression = {}) {
+        compile(expression);
+    }
+
+    // convert to postfix notation using shunting yard algorithm
+    constexpr void compile(const std::vector<token<T>>& expression) {
+        std::vector<special_char::type>& stack = operators;
+        stack.clear();
+        program.clear();
+        pool.clear();
+        slots.clear();
+        bool balanced = true;
+
+        for (const auto& current_token : expression) {
+            if (std::holds_alternative<T>(current_token)) {
+                program.push_back(opcode::CONSTANT);
+                pool.push_back(std::get<T>(current_token));
+                continue;
+            }
+
+            if (std::holds_alternative<variable>(current_token)) {
+                program.push_back(opcode::VARIABLE);
+                slots.push_back(static_cast<uint32_t>(std::get<variable>(current_token).index));
+                continue;
+            }
+
+            // the token is a special character
+            special_char::type op = std::get<special_char>(current_token).value;
+            switch (op) {
+                case special_char::PLUS:
+                case special_char::MINUS:
+                    while (!stack.empty() && stack.back() != special_char::LEFT_PARENTHESIS) {
+                        program.push_back(opcode_of(stack.back()));
+                        stack.pop_back();
+                    }
+                    stack.push_back(op);
+                    break;
+                case special_char::MULTIPLY:
+                case special_char::DIVIDE:
+                case special_char::LEFT_PARENTHESIS:
+                    stack.push_back(op);
+                    break;
+                case special_char::RIGHT_PARENTHESIS:
+                    while (!stack.empty() && stack.back() != special_char::LEFT_PARENTHESIS) {
+                        program.push_back(opcode_of(stack.back()));
+                        stack.pop_back();
+                    }
+                    // unmatched right parenthesis
+                    if (stack.empty()) {
+                        balanced = false;
+                    } else {
+                        stack.pop_back();
+                    }
+                    break;
+            }
+        }
+
+        well_formed = balanced;
+        while (!stack.empty()) {
+            // unmatched left parenthesis
+            if (stack.back() == special_char::LEFT_PARENTHESIS) {
+                well_formed = false;
+            } else {
+                program.push_back(opcode_of(stack.back()));
+            }
+            stack.pop_back();
+        }
+
+        finish();
+    }
+
+    // load a program that is already in postfix order, such as the output of postfix() or of an optimization pass
+    constexpr void assemble(const std::vector<token<T>>& postfix) {
+        program.clear();
+        pool.clear();
+        slots.clear();
+
+        for (const auto& current_token : postfix) {
+            if (std::holds_alternative<T>(current_token)) {
+                program.push_back(opcode::CONSTANT);
+                pool.push_back(std::get<T>(current_token));
+            } else if (std::holds_alternative<variable>(current_token)) {
+                program.push_back(opcode::VARIABLE);
+                slots.push_back(static_cast<uint32_t>(std::get<variable>(current_token).index));
+            } else {
+                program.push_back(opcode_of(std::get<special_char>(current_token).value));
+            }
+        }
+
+        well_formed = true;
+        finish();
+    }
+
+    // true if every operator has both operands and the program leaves exactly one value
+    constexpr bool valid() const {
+        return well_formed;
+    }
+
+    // evaluate postfix expression, reusing the preallocated stack; variables[i] is the value of variable slot i;
+    // a malformed program evaluates to T()
+    constexpr T evaluate(const T* variables = nullptr) {
+        if (!well_formed) {
+            return T();
+        }
+        T* top = values.data();
+        const T* constant = pool.data();
+        const uint32_t* slot = slots.data();
+
+        for (opcode op : program) {
+            if (op == opcode::CONSTANT) {
+                *top++ = *constant++;
+            } else if (op == opcode::VARIABLE) {
+                *top++ = variables[*slot++];
+            } else {
+                top--;
+                top[-1] = apply_operator(operator_of(op), top[-1], top[0]);
+            }
+        }
+
+        return values[0];
+    }
+
+    constexpr const std::vector<opcode>& code() const {
+        return program;
+    }
+
+    constexpr const std::vector<T>& constants() const {
+        return pool;
+    }
+
+    constexpr const std::vector<uint32_t>& variable_slots() const {
+        return slots;
+    }
+
+    // the program decoded back into postfix tokens
+    constexpr std::vector<token<T>> postfix() const {
+        std::vector<token<T>> tokens;
+        size_t constant = 0, slot = 0;
+        for (opcode op : program) {
+            if (op == opcode::CONSTANT) {
+                tokens.push_back(pool[constant++]);
+            } else if (op == opcode::VARIABLE) {
+                tokens.push_back(variable{slots[slot++]});
+            } else {
+                tokens.push_back(special_char{operator_of(op)});
+            }
+        }
+        return tokens;
+    }
+
+    // memory the program itself occupies, without the evaluation stack
+    constexpr size_t program_bytes() const {
+        return program.size() * sizeof(opcode) + pool.size() * sizeof(T) + slots.size() * sizeof(uint32_t);
+    }
+
+    // largest number of values live at once during evaluation
+    constexpr size_t stack_depth() const {
+        return max_depth;
+    }
+
+    // number of variable slots the program reads
+    constexpr size_t variables() const {
+        return variable_count;
+    }
+
+private:
+
+    std::vector<opcode> program;
+    std::vector<T> pool;
+    std::vector<uint32_t> slots;
+    std::vector<T> values;
+    std::vector<special_char::type> operators;
+    size_t max_depth = 0;
+    size_t variable_count = 0;
+    bool well_formed = false;
+
+    // checks operand counts and sizes the evaluation stack once, so that evaluation never allocates
+    constexpr void finish() {
+        size_t depth = 0;
+        max_depth = 0;
+        for (opcode op : program) {
+            if (op == opcode::CONSTANT || op == opcode::VARIABLE) {
+                depth++;
+            } else if (depth >= 2) {
+                depth--;
+            } else {
+                well_formed = false;
+            }
+            max_depth = std::max(max_depth, depth);
+        }
+        well_formed = well_formed && depth == 1;
+        values.assign(max_depth + 1, T());
+
+        variable_count = 0;
+        for (uint32_t slot : slots) {
+            variable_count = std::max<size_t>(variable_count, slot + 1);
+        }
+    }
+};
+
+// optimization pass over a compiled program: rebuilds the expression tree, folds operators whose operands are
+// both constants, drops identities that are exact for T, and cancels the -1 * the parser inserts for a negated
+// parenthesis or variable wherever the negation can move into a neighbouring operator; the result evaluates to
+// the same bits as the original, so x+0 and x*0 are only simplified for integer T, where -0, NaN and infinity
+// cannot appear; fast math additionally treats + and * as associative, which changes rounding
+template <typename T>
+class expression_optimizer {
+public:
+
+    // malformed programs are returned unchanged
+    compiled_expression<T> optimize(const compiled_expression<T>& expression, bool fast_math = false) {
+        if (!expression.valid()) {
+            return expression;
+        }
+
+        nodes.clear();
+        std::vector<uint32_t>& stack = pending;
+        stack.clear();
+        size_t constant = 0, slot = 0;
+        for (opcode op : expression.code()) {
+            if (op == opcode::CONSTANT) {
+                stack.push_back(make_constant(expression.constants()[constant++]));
+            } else if (op == opcode::VARIABLE) {
+                stack.push_back(add({opcode::VARIABLE, T(), expression.variable_slots()[slot++], 0, 0}));
+            } else {
+                uint32_t rhs = stack.back();
+                stack.pop_back();
+                stack.back() = combine(op, stack.back(), rhs);
+            }
+        }
+
+        uint32_t root = fast_math ? rebalance(stack.back()) : stack.back();
+        compiled_expression<T> optimized;
+        optimized.assemble(emit(root));
+        return optimized;
+    }
+
+private:
+
+    struct node {
+        opcode op;
+        T value;
+        uint32_t slot;
+        uint32_t lhs;
+        uint32_t rhs;
+    };
+
+    std::vector<node> nodes;
+    std::vector<uint32_t> pending;
+
+    uint32_t add(const node& n) {
+        nodes.push_back(n);
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    uint32_t make_constant(const T& value) {
+        return add({opcode::CONSTANT, value, 0, 0, 0});
+    }
+
+    uint32_t make_operator(opcode op, uint32_t lhs, uint32_t rhs) {
+        return add({op, T(), 0, lhs, rhs});
+    }
+
+    bool is_constant(uint32_t index, int value) const {
+        return nodes[index].op == opcode::CONSTANT && nodes[index].value == T(value);
+    }
+
+    // zero with the sign bit clear, x-(+0) is x even for x = -0
+    bool is_positive_zero(uint32_t index) const {
+        if constexpr (std::is_floating_point_v<T>) {
+            return is_constant(index, 0) && !std::signbit(nodes[index].value);
+        } else {
+            return is_constant(index, 0);
+        }
+    }
+
+    // zero with the sign bit set, x+(-0) is x even for x = -0
+    bool is_negative_zero(uint32_t index) const {
+        if constexpr (std::is_floating_point_v<T>) {
+            return is_constant(index, 0) && std::signbit(nodes[index].value);
+        } else {
+            return false;
+        }
+    }
+
+    // -1 * x, as the parser writes a negation; negating is exact, so it may move between operators
+    bool is_negation(uint32_t index) const {
+        return nodes[index].op == opcode::MULTIPLY && is_constant(nodes[index].lhs, -1);
+    }
+
+    uint32_t negated(uint32_t index) const {
+        return nodes[index].rhs;
+    }
+
+    // chains that may be reassociated under fast math: 1 for + and -, 2 for *, 0 for anything else
+    int chain_of(uint32_t index) const {
+        opcode op = nodes[index].op;
+        return op == opcode::PLUS || op == opcode::MINUS ? 1 : op == opcode::MULTIPLY ? 2 : 0;
+    }
+
+    // fast math: flattens every chain of + and - and every chain of * into its terms, folds the constants among
+    // them and rebuilds the chain as a balanced tree, so a+b+c+d becomes (a+b)+(c+d) and its two halves can run
+    // in parallel; children are always created before their parents, so one pass in index order suffices
+    uint32_t rebalance(uint32_t root) {
+        size_t count = root + 1;
+        std::vector<bool> reachable(count), interior(count);
+        reachable[root] = true;
+        for (size_t i = count; i-- > 0;) {
+            if (!reachable[i] || nodes[i].op == opcode::CONSTANT || nodes[i].op == opcode::VARIABLE) {
+                continue;
+            }
+            for (uint32_t child : {nodes[i].lhs, nodes[i].rhs}) {
+                reachable[child] = true;
+                interior[child] = interior[child] || (chain_of(child) != 0 && chain_of(child) == chain_of(i));
+            }
+        }
+
+        std::vector<uint32_t> rebuilt(count);
+        for (uint32_t i = 0; i < count; i++) {
+            if (!reachable[i] || interior[i]) {
+                continue;
+            }
+            if (nodes[i].op == opcode::CONSTANT || nodes[i].op == opcode::VARIABLE) {
+                rebuilt[i] = i;
+            } else if (nodes[i].op == opcode::DIVIDE) {
+                rebuilt[i] = combine(opcode::DIVIDE, rebuilt[nodes[i].lhs], rebuilt[nodes[i].rhs]);
+            } else {
+                rebuilt[i] = chain_of(i) == 1 ? rebuild_sum(i, rebuilt) : rebuild_product(i, rebuilt);
+            }
+        }
+        return rebuilt[root];
+    }
+
+    // terms of a + and - chain with their signs, added up pairwise; a negative total is negated at the end
+    uint32_t rebuild_sum(uint32_t chain, const std::vector<uint32_t>& rebuilt) {
+        std::vector<std::pair<uint32_t, bool>> terms, walk = {{chain, false}};
+        T constant = T(0);
+        while (!walk.empty()) {
+            auto [index, negative] = walk.back();
+            walk.pop_back();
+            if (chain_of(index) == 1) {
+                walk.push_back({nodes[index].rhs, nodes[index].op == opcode::MINUS ? !negative : negative});
+                walk.push_back({nodes[index].lhs, negative});
+                continue;
+            }
+
+            uint32_t term = rebuilt[index];
+            if (is_negation(term)) {
+                term = negated(term);
+                negative = !negative;
+            }
+            if (nodes[term].op == opcode::CONSTANT) {
+                constant = negative ? constant - nodes[term].value : constant + nodes[term].value;
+            } else {
+                terms.push_back({term, negative});
+            }
+        }
+        if (terms.empty() || constant != T(0)) {
+            terms.push_back({make_constant(constant), false});
+        }
+
+        while (terms.size() > 1) {
+            size_t half = 0;
+            for (size_t k = 0; k + 1 < terms.size(); k += 2) {
+                auto [lhs, lhs_negative] = terms[k];
+                auto [rhs, rhs_negative] = terms[k + 1];
+                if (lhs_negative && !rhs_negative) {
+                    terms[half++] = {make_operator(opcode::MINUS, rhs, lhs), false};
+                } else {
+                    terms[half++] = {make_operator(lhs_negative == rhs_negative ? opcode::PLUS : opcode::MINUS, lhs, rhs), lhs_negative};
+                }
+            }
+            if (terms.size() % 2 == 1) {
+                terms[half++] = terms.back();
+            }
+            terms.resize(half);
+        }
+
+        auto [sum, negative] = terms[0];
+        return negative ? make_operator(opcode::MULTIPLY, make_constant(T(-1)), sum) : sum;
+    }
+
+    // factors of a * chain multiplied pairwise, with their constants folded into one leading factor
+    uint32_t rebuild_product(uint32_t chain, const std::vector<uint32_t>& rebuilt) {
+        std::vector<uint32_t> factors, walk = {chain};
+        T constant = T(1);
+        while (!walk.empty()) {
+            uint32_t index = walk.back();
+            walk.pop_back();
+            if (chain_of(index) == 2) {
+                walk.push_back(nodes[index].rhs);
+                walk.push_back(nodes[index].lhs);
+            } else if (nodes[rebuilt[index]].op == opcode::CONSTANT) {
+                constant = constant * nodes[rebuilt[index]].value;
+            } else {
+                factors.push_back(rebuilt[index]);
+            }
+        }
+        if (factors.empty()) {
+            return make_constant(constant);
+        }
+
+        while (factors.size() > 1) {
+            size_t half = 0;
+            for (size_t k = 0; k + 1 < factors.size(); k += 2) {
+                factors[half++] = make_operator(opcode::MULTIPLY, factors[k], factors[k + 1]);
+            }
+            if (factors.size() % 2 == 1) {
+                factors[half++] = factors.back();
+            }
+            factors.resize(half);
+        }
+
+        return constant == T(1) ? factors[0] : make_operator(opcode::MULTIPLY, make_constant(constant), factors[0]);
+    }
+
+    uint32_t combine(opcode op, uint32_t lhs, uint32_t rhs) {
+        if (nodes[lhs].op == opcode::CONSTANT && nodes[rhs].op == opcode::CONSTANT
+            && !(std::is_integral_v<T> && op == opcode::DIVIDE && nodes[rhs].value == T(0))) {
+            return make_constant(apply_operator(operator_of(op), nodes[lhs].value, nodes[rhs].value));
+        }
+
+        switch (op) {
+            case opcode::PLUS:
+                if (is_negative_zero(rhs) || (std::is_integral_v<T> && is_constant(rhs, 0))) {
+                    return lhs;
+                }
+                if (is_negative_zero(lhs) || (std::is_integral_v<T> && is_constant(lhs, 0))) {
+                    return rhs;
+                }
+                if (is_negation(rhs)) {
+                    return make_operator(opcode::MINUS, lhs, negated(rhs));
+                }
+                break;
+            case opcode::MINUS:
+                if (is_positive_zero(rhs)) {
+                    return lhs;
+                }
+                if (is_negation(rhs)) {
+                    return make_operator(opcode::PLUS, lhs, negated(rhs));
+                }
+                break;
+            case opcode::MULTIPLY:
+                if (is_constant(rhs, 1)) {
+                    return lhs;
+                }
+                if (is_constant(lhs, 1)) {
+                    return rhs;
+                }
+                if (std::is_integral_v<T> && (is_constant(lhs, 0) || is_constant(rhs, 0))) {
+                    return make_constant(T(0));
+                }
+                if (is_constant(lhs, -1) && is_negation(rhs)) {
+                    return negated(rhs);
+                }
+                // -(a*-b) is a*b, as in -(x)*-(y), where right associativity nests the second negation
+                if (is_constant(lhs, -1) && (nodes[rhs].op == opcode::MULTIPLY || nodes[rhs].op == opcode::DIVIDE)) {
+                    const node& product = nodes[rhs];
+                    if (is_negation(product.lhs)) {
+                        return make_operator(product.op, negated(product.lhs), product.rhs);
+                    }
+                    if (is_negation(product.rhs)) {
+                        return make_operator(product.op, product.lhs, negated(product.rhs));
+                    }
+                }
+                if (is_constant(rhs, -1) && is_negation(lhs)) {
+                    return negated(lhs);
+                }
+                if (is_negation(lhs) && is_negation(rhs)) {
+                    return make_operator(opcode::MULTIPLY, negated(lhs), negated(rhs));
+                }
+                break;
+            case opcode::DIVIDE:
+                if (is_constant(rhs, 1)) {
+                    return lhs;
+                }
+                if (is_negation(lhs) && is_negation(rhs)) {
+                    return make_operator(opcode::DIVIDE, negated(lhs), negated(rhs));
+                }
+                break;
+            default:
+                break;
+        }
+
+        return make_operator(op, lhs, rhs);
+    }
+
+    // postfix order without recursion, so deeply nested expressions cannot exhaust the call stack
+    std::vector<token<T>> emit(uint32_t root) {
+        std::vector<token<T>> postfix;
+        std::vector<std::pair<uint32_t, bool>> walk = {{root, false}};
+        while (!walk.empty()) {
+            auto [index, expanded] = walk.back();
+            walk.pop_back();
+            const node& current = nodes[index];
+            if (current.op == opcode::CONSTANT) {
+                postfix.push_back(current.value);
+            } else if (current.op == opcode::VARIABLE) {
+                postfix.push_back(variable{current.slot});
+            } else if (expanded) {
+                postfix.push_back(special_char{operator_of(current.op)});
+            } else {
+                walk.push_back({index, true});
+                walk.push_back({current.rhs, false});
+                walk.push_back({current.lhs, false});
+            }
+        }
+        return postfix;
+    }
+};
+
+// optimized copy of a compiled program, fast math allows reassociation
+template <typename T>
+compiled_expression<T> optimize(const compiled_expression<T>& expression, bool fast_math = false) {
+    return expression_optimizer<T>().optimize(expression, fast_math);
+}
+
+// hash-consed expression DAG: every distinct subexpression of every added program is stored once, identified by
+// its operator and operand nodes, and constants by their bits so 0 and -0 stay apart; nodes are created after
+// their operands, so one pass in node order evaluates all expressions with each shared subexpression computed once
+template <typename T>
+class expression_dag {
+public:
+
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(uint64_t), "constants are keyed by their bits");
+
+    // adds a valid compiled expression, reusing the nodes of subtrees already present; returns its expression index
+    size_t add(const compiled_expression<T>& expression) {
+        std::vector<uint32_t>& stack = pending;
+        stack.clear();
+        size_t constant = 0, slot = 0;
+        for (opcode op : expression.code()) {
+            if (op == opcode::CONSTANT) {
+                stack.push_back(intern(op, 0, 0, expression.constants()[constant++]));
+            } else if (op == opcode::VARIABLE) {
+                stack.push_back(intern(op, expression.variable_slots()[slot++], 0, T()));
+            } else {
+                uint32_t rhs = stack.back();
+                stack.pop_back();
+                stack.back() = intern(op, stack.back(), rhs, T());
+            }
+        }
+
+        tree_size += expression.code().size();
+        roots.push_back(stack.back());
+        return roots.size() - 1;
+    }
+
+    // computes every node once; variables[i] is the value of variable slot i in all expressions
+    void evaluate(const T* variables = nullptr) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const node& current = nodes[i];
+            if (current.op == opcode::CONSTANT) {
+                values[i] = current.value;
+            } else if (current.op == opcode::VARIABLE) {
+                values[i] = variables[current.lhs];
+            } else {
+                values[i] = apply_operator(operator_of(current.op), values[current.lhs], values[current.rhs]);
+            }
+        }
+    }
+
+    // value of an expression as of the last evaluate()
+    T result(size_t expression) const {
+        return values[roots[expression]];
+    }
+
+    size_t expressions() const {
+        return roots.size();
+    }
+
+    // distinct subexpressions stored
+    size_t node_count() const {
+        return nodes.size();
+    }
+
+    // nodes the added programs have in total, what separate trees would store
+    size_t tree_node_count() const {
+        return tree_size;
+    }
+
+    // memory of the nodes, their values, the roots and the hash-consing index
+    size_t bytes() const {
+        return nodes.size() * (sizeof(node) + sizeof(T)) + (roots.size() + table.size()) * sizeof(uint32_t);
+    }
+
+private:
+
+    struct node {
+        opcode op;
+        // operand nodes, or the variable slot in lhs
+        uint32_t lhs;
+        uint32_t rhs;
+        T value;
+    };
+
+    std::vector<node> nodes;
+    std::vector<T> values;
+    std::vector<uint32_t> roots;
+    std::vector<uint32_t> pending;
+    // open-addressed index of node numbers with linear probing, kept at most half full
+    std::vector<uint32_t> table;
+    size_t tree_size = 0;
+
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    static uint64_t bits_of(opcode op, const T& value) {
+        uint64_t bits = 0;
+        if (op == opcode::CONSTANT) {
+            std::memcpy(&bits, &value, sizeof(T));
+        }
+        return bits;
+    }
+
+    static size_t hash(opcode op, uint32_t lhs, uint32_t rhs, uint64_t bits) {
+        uint64_t hash = bits ^ (static_cast<uint64_t>(lhs) << 32 | rhs) * 0x9E3779B97F4A7C15ull;
+        hash ^= static_cast<uint64_t>(op) + (hash >> 29);
+        hash *= 0xBF58476D1CE4E5B9ull;
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+
+    void grow() {
+        table.assign(std::max<size_t>(1024, table.size() * 2), EMPTY);
+        size_t mask = table.size() - 1;
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            const node& current = nodes[i];
+            size_t slot = hash(current.op, current.lhs, current.rhs, bits_of(current.op, current.value)) & mask;
+            while (table[slot] != EMPTY) {
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = i;
+        }
+    }
+
+    uint32_t intern(opcode op, uint32_t lhs, uint32_t rhs, const T& value) {
+        if (2 * (nodes.size() + 1) > table.size()) {
+            grow();
+        }
+
+        uint64_t bits = bits_of(op, value);
+        size_t mask = table.size() - 1;
+        for (size_t slot = hash(op, lhs, rhs, bits) & mask;; slot = (slot + 1) & mask) {
+            uint32_t candidate = table[slot];
+            if (candidate == EMPTY) {
+                table[slot] = static_cast<uint32_t>(nodes.size());
+                nodes.push_back({op, lhs, rhs, value});
+                values.push_back(T());
+                return table[slot];
+            }
+            const node& existing = nodes[candidate];
+            if (existing.op == op && existing.lhs == lhs && existing.rhs == rhs && bits_of(op, existing.value) == bits) {
+                return candidate;
+            }
+        }
+    }
+};
+
+// fork-join thread pool: every thread has its own task deque, runs its newest task first and, once that is empty,
+// steals the oldest task of another thread; a thread waiting for a group of tasks runs tasks instead of blocking
+class work_stealing_pool {
+public:
+
+    // the tasks spawned into a group have all finished when wait returns
+    class task_group {
+        friend class work_stealing_pool;
+        std::atomic<size_t> pending{0};
+    };
+
+    // threads counts the caller, which takes part in the work while it waits
+    explicit work_stealing_pool(size_t threads) : queues(std::max<size_t>(threads, 1)) {
+        for (size_t i = 1; i < queues.size(); i++) {
+            workers.emplace_back([this, i]() { run(i); });
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    ~work_stealing_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t threads() const {
+        return queues.size();
+    }
+
+    void spawn(task_group& group, std::function<void()> work) {
+        group.pending++;
+        queued++;
+        queue& own = queues[own_queue()];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.tasks.push_back({std::move(work), &group});
+        }
+        // a worker that has just found nothing to do is either still holding the lock or already waiting
+        { std::lock_guard<std::mutex> lock(mutex); }
+        condition.notify_one();
+    }
+
+    void wait(task_group& group) {
+        size_t own = own_queue();
+        while (group.pending.load(std::memory_order_acquire) != 0) {
+            if (!run_one(own)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+
+    struct task {
+        std::function<void()> work;
+        task_group* group;
+    };
+
+    struct queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    // queue 0 belongs to the threads outside the pool
+    std::vector<queue> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<size_t> queued{0};
+    bool stopping = false;
+
+    static inline thread_local const work_stealing_pool* current_pool = nullptr;
+    static inline thread_local size_t current_queue = 0;
+
+    size_t own_queue() const {
+        return current_pool == this ? current_queue : 0;
+    }
+
+    bool run_one(size_t own) {
+        std::optional<task> next;
+        for (size_t i = 0; i < queues.size() && !next.has_value(); i++) {
+            queue& victim = queues[(own + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                next = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+            } else {
+                next = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+        if (!next.has_value()) {
+            return false;
+        }
+
+        queued--;
+        next->work();
+        next->group->pending.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void run(size_t index) {
+        current_pool = this;
+        current_queue = index;
+        while (true) {
+            if (run_one(index)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping) {
+                return;
+            }
+        }
+    }
+};
+
+// subtrees smaller than this many nodes are evaluated without forking
+const size_t TREE_TASK_CUTOFF = 1 << 12;
+
+// expression tree for fork-join evaluation; nodes are stored in postfix order, so a subtree is the run of nodes that
+// ends at its root and a small one is evaluated by a single pass over that run; a large subtree is followed down
+// its larger children, the other children along that path become tasks, small ones grouped until a task holds
+// cutoff nodes, and the path is folded back up once they are done; every node applies the operator of the program
+// to the same operands, so the result has the same bits as the stack walk
+template <typename T>
+class expression_tree {
+public:
+
+    // expression must be valid
+    explicit expression_tree(const compiled_expression<T>& expression, size_t cutoff = TREE_TASK_CUTOFF)
+        : cutoff(std::max<size_t>(cutoff, 2)) {
+        std::vector<uint32_t> stack;
+        size_t constant = 0, slot = 0;
+        for (opcode op : expression.code()) {
+            uint32_t index = static_cast<uint32_t>(nodes.size());
+            if (op == opcode::CONSTANT) {
+                nodes.push_back({op, 0, 0, 1, expression.constants()[constant++]});
+            } else if (op == opcode::VARIABLE) {
+                nodes.push_back({op, expression.variable_slots()[slot++], 0, 1, T()});
+            } else {
+                uint32_t rhs = stack.back();
+                stack.pop_back();
+                uint32_t lhs = stack.back();
+                stack.pop_back();
+                nodes.push_back({op, lhs, rhs, nodes[lhs].size + nodes[rhs].size + 1, T()});
+            }
+            stack.push_back(index);
+        }
+        values.resize(nodes.size());
+    }
+
+    // single pass over all nodes; variables[i] is the value of variable slot i
+    T evaluate(const T* variables = nullptr) {
+        evaluate_run(0, nodes.size(), variables);
+        return values.back();
+    }
+
+    // fork-join evaluation on the pool's threads
+    T evaluate(work_stealing_pool& pool, const T* variables = nullptr) {
+        evaluate_subtree(static_cast<uint32_t>(nodes.size() - 1), variables, pool);
+        return values.back();
+    }
+
+    size_t size() const {
+        return nodes.size();
+    }
+
+private:
+
+    struct node {
+        opcode op;
+        // operand nodes, or the variable slot in lhs
+        uint32_t lhs;
+        uint32_t rhs;
+        // nodes in the subtree, this one included
+        uint32_t size;
+        T value;
+    };
+
+    std::vector<node> nodes;
+    std::vector<T> values;
+    size_t cutoff;
+
+    void evaluate_run(size_t begin, size_t end, const T* variables) {
+        for (size_t i = begin; i < end; i++) {
+            const node& current = nodes[i];
+            if (current.op == opcode::CONSTANT) {
+                values[i] = current.value;
+            } else if (current.op == opcode::VARIABLE) {
+                values[i] = variables[current.lhs];
+            } else {
+                values[i] = apply_operator(operator_of(current.op), values[current.lhs], values[current.rhs]);
+            }
+        }
+    }
+
+    void evaluate_small(uint32_t root, const T* variables) {
+        evaluate_run(root + 1 - nodes[root].size, root + 1, variables);
+    }
+
+    void evaluate_subtree(uint32_t root, const T* variables, work_stealing_pool& pool) {
+        // the path of larger children down to the first small subtree; path[i + 1] is a child of path[i]
+        std::vector<uint32_t> path = {root};
+        while (nodes[path.back()].size >= cutoff) {
+            const node& current = nodes[path.back()];
+            path.push_back(nodes[current.lhs].size >= nodes[current.rhs].size ? current.lhs : current.rhs);
+        }
+        auto sibling = [&](size_t i) {
+            return nodes[path[i]].lhs == path[i + 1] ? nodes[path[i]].rhs : nodes[path[i]].lhs;
+        };
+
+        work_stealing_pool::task_group group;
+        size_t first = 0, batch = 0;
+        for (size_t i = 0; i + 1 < path.size(); i++) {
+            uint32_t other = sibling(i);
+            if (nodes[other].size >= cutoff) {
+                pool.spawn(group, [this, other, variables, &pool]() { evaluate_subtree(other, variables, pool); });
+                continue;
+            }
+            batch += nodes[other].size;
+            if (batch >= cutoff) {
+                pool.spawn(group, [this, first, i, variables, &sibling]() {
+                    for (size_t j = first; j <= i; j++) {
+                        if (nodes[sibling(j)].size < cutoff) {
+                            evaluate_small(sibling(j), variables);
+                        }
+                    }
+                });
+                first = i + 1;
+                batch = 0;
+            }
+        }
+        for (size_t j = first; j + 1 < path.size(); j++) {
+            if (nodes[sibling(j)].size < cutoff) {
+                evaluate_small(sibling(j), variables);
+            }
+        }
+        evaluate_small(path.back(), variables);
+        pool.wait(group);
+
+        for (size_t i = path.size() - 1; i-- > 0;) {
+            const node& current = nodes[path[i]];
+            values[path[i]] = apply_operator(operator_of(current.op), values[current.lhs], values[current.rhs]);
+        }
+    }
+};
+
+// expression evaluator; nullopt for a malformed expression
+template <typename T>
+std::optional<T> evaluate(const std::vector<token<T>>& expression) {
+    compiled_expression<T> compiled(expression);
+    return compiled.valid() ? std::make_optional(compiled.evaluate()) : std::nullopt;
+}
+
+// reusable buffers for evaluating one expression after another, nothing is allocated once they have grown
+template <typename T>
+struct scratch_arena {
+    std::string input;
+    std::vector<token<T>> tokens;
+    compiled_expression<T> compiled;
+};
+
+// strips whitespace, then parses and compiles into the arena's program using only the arena's storage
+template <typename T>
+void compile(std::string_view expression, scratch_arena<T>& arena) {
+    arena.input.clear();
+    for (char c : expression) {
+        if (!isspace(static_cast<unsigned char>(c))) {
+            arena.input += c;
+        }
+    }
+
+    parse<T>(std::nullopt, arena.input, arena.tokens);
+    arena.compiled.compile(arena.tokens);
+}
+
+// compiles and evaluates using only the arena's storage; nullopt for a malformed expression
+template <typename T>
+std::optional<T> evaluate(std::string_view expression, scratch_arena<T>& arena) {
+    compile(expression, arena);
+    if (!arena.compiled.valid()) {
+        return std::nullopt;
+    }
+    return arena.compiled.evaluate();
+}
+
+// programs with at least this many opcodes are worth evaluating fork-join
+const size_t TREE_MIN_NODES = 1 << 16;
+
+// like the arena evaluation, but a program of at least min_nodes opcodes is evaluated as a tree on the pool;
+// the result has the same bits either way
+template <typename T>
+std::optional<T> evaluate(std::string_view expression, scratch_arena<T>& arena, work_stealing_pool& pool,
+                          size_t min_nodes = TREE_MIN_NODES) {
+    compile(expression, arena);
+    if (!arena.compiled.valid()) {
+        return std::nullopt;
+    }
+    if (arena.compiled.code().size() < min_nodes) {
+        return arena.compiled.evaluate();
+    }
+    return expression_tree<T>(arena.compiled).evaluate(pool);
+}
+
+// fixed-capacity stack kept inline, push reports overflow instead of allocating
+template <typename U, size_t N>
+class inline_stack {
+public:
+
+    constexpr bool push(const U& item) {
+        if (count == N) {
+            return false;
+        }
+        items[count++] = item;
+        return true;
+    }
+
+    constexpr U pop() {
+        return items[--count];
+    }
+
+    constexpr U& top() {
+        return items[count - 1];
+    }
+
+    constexpr size_t size() const {
+        return count;
+    }
+
+    constexpr bool empty() const {
+        return count == 0;
+    }
+
+private:
+
+    std::array<U, N> items;
+    size_t count = 0;
+};
+
+// stack with the inline_stack interface that grows instead, remembering the most items it ever held
+template <typename U>
+class growing_stack {
+public:
+
+    bool push(const U& item) {
+        items.push_back(item);
+        high_water = std::max(high_water, items.size());
+        return true;
+    }
+
+    U pop() {
+        U item = items.back();
+        items.pop_back();
+        return item;
+    }
+
+    U& top() {
+        return items.back();
+    }
+
+    size_t size() const {
+        return items.size();
+    }
+
+    bool empty() const {
+        return items.empty();
+    }
+
+    size_t peak() const {
+        return high_water;
+    }
+
+private:
+
+    std::vector<U> items;
+    size_t high_water = 0;
+};
+
+// values and pending operators the one-pass evaluator keeps inline before falling back to the compiled path
+const size_t FUSED_STACK_SIZE = 64;
+
+template <typename U>
+using fused_stack = inline_stack<U, FUSED_STACK_SIZE>;
+
+// token sink that resolves precedence and computes as tokens arrive, by reducing operators at the point where the
+// shunting yard algorithm would emit them; it only holds what is still pending, so its stacks grow with the depth
+// of the parse tree and not with the length of the input
+template <typename T, template <typename> class Stack>
+class reducing_evaluator {
+public:
+
+    constexpr void operator()(const token<T>& current_token) {
+        if (malformed || overflow) {
+            return;
+        }
+
+        if (std::holds_alternative<T>(current_token)) {
+            overflow = !values.push(std::get<T>(current_token));
+            return;
+        }
+
+        // without a variable table the only other tokens are special characters
+        special_char::type op = std::get<special_char>(current_token).value;
+        switch (op) {
+            case special_char::PLUS:
+            case special_char::MINUS:
+                reduce_to_parenthesis();
+                overflow = !operators.push(op);
+                break;
+            case special_char::MULTIPLY:
+            case special_char::DIVIDE:
+            case special_char::LEFT_PARENTHESIS:
+                overflow = !operators.push(op);
+                break;
+            case special_char::RIGHT_PARENTHESIS:
+                reduce_to_parenthesis();
+                // unmatched right parenthesis, as for a compiled program
+                if (operators.empty()) {
+                    malformed = true;
+                } else {
+                    operators.pop();
+                }
+                break;
+        }
+    }
+
+    // a stack was full, so the result is unknown
+    constexpr bool overflowed() const {
+        return overflow;
+    }
+
+    // reduces what is left; nullopt for a malformed expression
+    constexpr std::optional<T> finish() {
+        while (!malformed && !operators.empty()) {
+            // unmatched left parenthesis
+            if (operators.top() == special_char::LEFT_PARENTHESIS) {
+                malformed = true;
+                break;
+            }
+            reduce();
+        }
+
+        if (malformed || values.size() != 1) {
+            return std::nullopt;
+        }
+        return values.top();
+    }
+
+    constexpr const Stack<T>& value_stack() const {
+        return values;
+    }
+
+    constexpr const Stack<special_char::type>& operator_stack() const {
+        return operators;
+    }
+
+private:
+
+    Stack<T> values;
+    Stack<special_char::type> operators;
+    bool malformed = false;
+    bool overflow = false;
+
+    constexpr void reduce() {
+        special_char::type op = operators.pop();
+        if (values.size() < 2) {
+            malformed = true;
+            return;
+        }
+        T a = values.pop();
+        values.top() = apply_operator(op, values.top(), a);
+    }
+
+    constexpr void reduce_to_parenthesis() {
+        while (!malformed && !operators.empty() && operators.top() != special_char::LEFT_PARENTHESIS) {
+            reduce();
+        }
+    }
+};
+
+// one-pass evaluator, tokenizes, resolves precedence and computes in a single left-to-right scan with inline stacks;
+// nullopt for a malformed expression
+template <typename T>
+std::optional<T> evaluate_line(const std::optional<token<T>>& previous_result, std::string_view expression) {
+    reducing_evaluator<T, fused_stack> evaluator;
+    tokenize<T>(previous_result, expression, evaluator);
+
+    if (evaluator.overflowed()) {
+        compiled_expression<T> compiled(parse<T>(previous_result, expression));
+        return compiled.valid() ? std::make_optional(compiled.evaluate()) : std::nullopt;
+    }
+    return evaluator.finish();
+}
+
+// text of one huge expression is split into pieces of this many bytes for the parallel passes; the pieces do not depend
+// on the number of threads, so neither does the result
+const size_t PARALLEL_CHUNK = 1 << 20;
+
+// runs task(i) for every i below count, each of threads threads taking the next index as soon as it is done with one
+template <typename Task>
+void parallel_for(size_t count, size_t threads, Task&& task) {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            task(i);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < std::min(threads, count); i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+// evaluates one whitespace-free expression on all cores: the parenthesis depth at the start of every chunk comes from a
+// prefix scan over per-chunk depth changes, then each chunk is cut at its first '+' or '-' at depth 0 that follows a
+// digit or ')', which the tokenizer always reads as a binary operator; the runs between cuts are sums of whole terms and
+// are evaluated independently, one after a '-' negated by a leading -1 *, which is exact, and the partial sums are
+// added left to right; rounding can differ from the sequential order, but not between runs or thread counts; nullopt
+// for a malformed expression
+template <typename T>
+std::optional<T> evaluate_parallel(std::string_view expression, size_t threads) {
+    auto sequential = [&]() {
+        reducing_evaluator<T, growing_stack> evaluator;
+        tokenize<T>(std::nullopt, expression, evaluator);
+        return evaluator.finish();
+    };
+
+    size_t chunks = (expression.size() + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+    if (chunks < 2) {
+        return sequential();
+    }
+
+    // depth change and lowest depth inside each chunk, relative to its start
+    std::vector<std::pair<ptrdiff_t, ptrdiff_t>> changes(chunks);
+    parallel_for(chunks, threads, [&](size_t chunk) {
+        ptrdiff_t depth = 0, lowest = 0;
+        size_t end = std::min(expression.size(), (chunk + 1) * PARALLEL_CHUNK);
+        for (size_t i = chunk * PARALLEL_CHUNK; i < end; i++) {
+            depth += (expression[i] == '(') - (expression[i] == ')');
+            lowest = std::min(lowest, depth);
+        }
+        changes[chunk] = {depth, lowest};
+    });
+
+    // an unmatched parenthesis anywhere leaves no depth 0 to cut at, the sequential parse reports it
+    std::vector<ptrdiff_t> depths(chunks);
+    ptrdiff_t depth = 0;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        depths[chunk] = depth;
+        if (depth + changes[chunk].second < 0) {
+            return sequential();
+        }
+        depth += changes[chunk].first;
+    }
+    if (depth != 0) {
+        return sequential();
+    }
+
+    std::vector<size_t> cuts(chunks, std::string_view::npos);
+    parallel_for(chunks, threads, [&](size_t chunk) {
+        ptrdiff_t depth = depths[chunk];
+        size_t end = std::min(expression.size(), (chunk + 1) * PARALLEL_CHUNK);
+        for (size_t i = std::max<size_t>(chunk * PARALLEL_CHUNK, 1); i < end; i++) {
+            char c = expression[i];
+            if (depth == 0 && (c == '+' || c == '-') && (is_digit(expression[i - 1]) || expression[i - 1] == ')')) {
+                cuts[chunk] = i;
+                return;
+            }
+            depth += (c == '(') - (c == ')');
+        }
+    });
+    cuts.erase(std::remove(cuts.begin(), cuts.end(), std::string_view::npos), cuts.end());
+    if (cuts.empty()) {
+        return sequential();
+    }
+
+    // the first run starts the sum, every later one begins just after the operator at its cut
+    std::vector<std::optional<T>> partial(cuts.size() + 1);
+    parallel_for(partial.size(), threads, [&](size_t run) {
+        size_t begin = run == 0 ? 0 : cuts[run - 1] + 1;
+        size_t end = run == cuts.size() ? expression.size() : cuts[run];
+        reducing_evaluator<T, growing_stack> evaluator;
+        if (run > 0 && expression[cuts[run - 1]] == '-') {
+            evaluator(parse_number<T>("-1"));
+            evaluator(special_char{special_char::MULTIPLY});
+        }
+        tokenize<T>(std::nullopt, expression.substr(begin, end - begin), evaluator);
+        partial[run] = evaluator.finish();
+    });
+
+    T sum = T(0);
+    for (size_t run = 0; run < partial.size(); run++) {
+        if (!partial[run].has_value()) {
+            return sequential();
+        }
+        sum = run == 0 ? partial[run].value() : sum + partial[run].value();
+    }
+    return sum;
+}
+
+// string literal usable as a template argument
+template <size_t N>
+struct fixed_string {
+    char data[N]{};
+
+    constexpr fixed_string(const char (&text)[N]) {
+        std::copy_n(text, N, data);
+    }
+
+    constexpr std::string_view view() const {
+        return std::string_view(data, N - 1);
+    }
+};
+
+// allocation-free postfix program with a size fixed at compile time, variables are passed in order of first appearance
+template <typename T, size_t N, size_t V>
+struct fixed_program {
+    static constexpr size_t size = N;
+    static constexpr size_t variables = V;
+
+    std::array<token<T>, N> program{};
+
+    // stack height just before the token at index runs
+    constexpr size_t depth_before(size_t index) const {
+        size_t depth = 0;
+        for (size_t i = 0; i < index; i++) {
+            depth = std::holds_alternative<special_char>(program[i]) ? depth - 1 : depth + 1;
+        }
+        return depth;
+    }
+
+    constexpr T evaluate(const std::array<T, V>& variables) const {
+        std::array<T, N> stack{};
+        size_t top = 0;
+
+        for (const auto& current_token : program) {
+            if (std::holds_alternative<T>(current_token)) {
+                stack[top++] = std::get<T>(current_token);
+            } else if (std::holds_alternative<variable>(current_token)) {
+                stack[top++] = variables[std::get<variable>(current_token).index];
+            } else {
+                top--;
+                stack[top - 1] = apply_operator(std::get<special_char>(current_token).value, stack[top - 1], stack[top]);
+            }
+        }
+
+        return stack[0];
+    }
+};
+
+template <typename T, fixed_string S>
+consteval auto build_fixed_program() {
+    constexpr auto shape = [] {
+        variable_table names;
+        compiled_expression<T> expression(parse<T>(std::nullopt, S.view(), &names));
+        return std::array<size_t, 3>{expression.code().size(), names.size(), expression.valid()};
+    }();
+    static_assert(shape[2], "malformed expression");
+
+    variable_table names;
+    compiled_expression<T> expression(parse<T>(std::nullopt, S.view(), &names));
+    fixed_program<T, shape[0], shape[1]> result;
+    std::vector<token<T>> postfix = expression.postfix();
+    std::copy(postfix.begin(), postfix.end(), result.program.begin());
+    return result;
+}
+
+// formula whose program is part of its type, evaluation unrolls into straight-line arithmetic
+template <typename T, fixed_string S>
+struct fixed_formula {
+    static constexpr auto program = build_fixed_program<T, S>();
+    static constexpr size_t V = program.variables;
+
+    template <typename... Args>
+    constexpr T operator()(Args... variables) const {
+        static_assert(sizeof...(Args) == V, "wrong number of variables");
+        return run(std::array<T, V>{static_cast<T>(variables)...}, std::make_index_sequence<program.size>());
+    }
+
+private:
+
+    template <size_t... I>
+    static constexpr T run(const std::array<T, V>& variables, std::index_sequence<I...>) {
+        std::array<T, program.size + 1> stack{};
+        (step<I>(stack, variables), ...);
+        return stack[0];
+    }
+
+    template <size_t I>
+    static constexpr void step(std::array<T, program.size + 1>& stack, const std::array<T, V>& variables) {
+        constexpr auto current_token = program.program[I];
+        constexpr size_t top = program.depth_before(I);
+
+        if constexpr (std::holds_alternative<T>(current_token)) {
+            stack[top] = std::get<T>(current_token);
+        } else if constexpr (std::holds_alternative<variable>(current_token)) {
+            stack[top] = variables[std::get<variable>(current_token).index];
+        } else {
+            stack[top - 2] = apply_operator(std::get<special_char>(current_token).value, stack[top - 2], stack[top - 1]);
+        }
+    }
+};
+
+// parses and compiles a formula during compilation; a formula without variables folds to its value,
+// one with variables becomes a fixed_formula
+template <typename T, fixed_string S>
+consteval auto compile_fixed() {
+    constexpr auto program = build_fixed_program<T, S>();
+
+    if constexpr (program.variables == 0) {
+        return program.evaluate({});
+    } else {
+        return fixed_formula<T, S>();
+    }
+}
+
+// "1+2*3"_expr is the float 7 at compile time, "x*2+1"_expr is a fixed_formula callable as f(x)
+template <fixed_string S>
+consteval auto operator""_expr() {
+    return compile_fixed<float, S>();
+}
+
+// vectorized kernels get AVX-512 and AVX2 clones picked at load time, with a plain x86-64 fallback
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define SIMD_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define SIMD_TARGET_CLONES
+#endif
+
+// rows evaluated together by every postfix operation of a column evaluation
+const size_t COLUMN_BLOCK = 256;
+
+template <typename T>
+SIMD_TARGET_CLONES
+void apply_operator_block(special_char::type op, T* out, const T* lhs, const T* rhs, size_t rows) {
+    // one loop per operator, so each one vectorizes on its own
+    switch (op) {
+        case special_char::PLUS:
+            for (size_t i = 0; i < rows; i++) out[i] = lhs[i] + rhs[i];
+            break;
+        case special_char::MINUS:
+            for (size_t i = 0; i < rows; i++) out[i] = lhs[i] - rhs[i];
+            break;
+        case special_char::MULTIPLY:
+            for (size_t i = 0; i < rows; i++) out[i] = lhs[i] * rhs[i];
+            break;
+        case special_char::DIVIDE:
+            for (size_t i = 0; i < rows; i++) out[i] = lhs[i] / rhs[i];
+            break;
+        default:
+            break;
+    }
+}
+
+// evaluates one compiled expression for every row, columns[v][row] is the value of variable v in that row;
+// each postfix operation runs over a whole block of rows instead of interpreting the program per row;
+// false, leaving out untouched, for a malformed program or fewer columns than the program has variables
+template <typename T>
+bool evaluate_columns(const compiled_expression<T>& expression, const std::vector<const T*>& columns, size_t rows, T* out) {
+    if (!expression.valid() || columns.size() < expression.variables()) {
+        return false;
+    }
+
+    size_t depth = expression.stack_depth();
+
+    // one scratch block per stack level, plus the broadcast constants
+    std::vector<T> scratch(depth * COLUMN_BLOCK);
+    std::vector<T> constants;
+    for (const T& constant : expression.constants()) {
+        constants.insert(constants.end(), COLUMN_BLOCK, constant);
+    }
+    std::vector<const T*> stack(depth);
+
+    for (size_t begin = 0; begin < rows; begin += COLUMN_BLOCK) {
+        size_t count = std::min(COLUMN_BLOCK, rows - begin);
+        const T* next_constant = constants.data();
+        const uint32_t* slot = expression.variable_slots().data();
+        size_t top = 0;
+
+        for (opcode op : expression.code()) {
+            if (op == opcode::CONSTANT) {
+                stack[top++] = next_constant;
+                next_constant += COLUMN_BLOCK;
+            } else if (op == opcode::VARIABLE) {
+                stack[top++] = columns[*slot++] + begin;
+            } else {
+                top--;
+                T* result = scratch.data() + (top - 1) * COLUMN_BLOCK;
+                apply_operator_block(operator_of(op), result, stack[top - 1], stack[top], count);
+                stack[top - 1] = result;
+            }
+        }
+
+        std::copy(stack[0], stack[0] + count, out + begin);
+    }
+    return true;
+}
+
+// expressions evaluated in a batch by one program per lane group
+const size_t SHAPE_LANES = 16;
+
+// SIMD across expressions: programs with the same opcodes and variable slots have the same shape whatever their
+// constants, so one pass over a shape's program evaluates SHAPE_LANES of its expressions, every lane reading the
+// constants of its own expression; each lane performs that expression's operations, so results have the same bits
+// as its own program; variables have the same values in all expressions
+template <typename T>
+class shape_batch {
+public:
+
+    // adds a valid compiled expression to the group of its shape; returns its expression index
+    size_t add(const compiled_expression<T>& expression) {
+        const std::vector<opcode>& code = expression.code();
+        const std::vector<uint32_t>& slots = expression.variable_slots();
+        key.assign(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(opcode));
+        key.append(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(uint32_t));
+
+        auto [found, inserted] = index.try_emplace(key, shapes.size());
+        if (inserted) {
+            shapes.push_back({code, slots, expression.constants().size(), {}, {}});
+            depth = std::max(depth, expression.stack_depth());
+            variable_count = std::max(variable_count, expression.variables());
+        }
+
+        // constants are stored lane by lane, constant k of lane l of a group at k * SHAPE_LANES + l
+        shape& group = shapes[found->second];
+        size_t lane = group.members.size() % SHAPE_LANES;
+        if (lane == 0) {
+            group.constants.resize(group.constants.size() + group.constant_count * SHAPE_LANES);
+        }
+        T* constants = group.constants.data() + group.constants.size() - group.constant_count * SHAPE_LANES;
+        for (size_t k = 0; k < group.constant_count; k++) {
+            constants[k * SHAPE_LANES + lane] = expression.constants()[k];
+        }
+
+        group.members.push_back(results.size());
+        results.push_back(T());
+        return results.size() - 1;
+    }
+
+    // evaluates every expression; variables[i] is the value of variable slot i in all of them
+    void evaluate(const T* variables = nullptr) {
+        scratch.resize(depth * SHAPE_LANES);
+        broadcast.resize(variable_count * SHAPE_LANES);
+        for (size_t v = 0; v < variable_count; v++) {
+            std::fill_n(broadcast.begin() + v * SHAPE_LANES, SHAPE_LANES, variables[v]);
+        }
+        std::vector<const T*>& stack = operands;
+        stack.resize(depth);
+
+        for (const shape& group : shapes) {
+            for (size_t first = 0; first < group.members.size(); first += SHAPE_LANES) {
+                size_t lanes = std::min(SHAPE_LANES, group.members.size() - first);
+                const T* constant = group.constants.data() + first * group.constant_count;
+                const uint32_t* slot = group.slots.data();
+                size_t top = 0;
+
+                for (opcode op : group.code) {
+                    if (op == opcode::CONSTANT) {
+                        stack[top++] = constant;
+                        constant += SHAPE_LANES;
+                    } else if (op == opcode::VARIABLE) {
+                        stack[top++] = broadcast.data() + *slot++ * SHAPE_LANES;
+                    } else {
+                        top--;
+                        T* result = scratch.data() + (top - 1) * SHAPE_LANES;
+                        apply_operator_block(operator_of(op), result, stack[top - 1], stack[top], lanes);
+                        stack[top - 1] = result;
+                    }
+                }
+
+                for (size_t lane = 0; lane < lanes; lane++) {
+                    results[group.members[first + lane]] = stack[0][lane];
+                }
+            }
+        }
+    }
+
+    // value of an expression as of the last evaluate()
+    T result(size_t expression) const {
+        return results[expression];
+    }
+
+    size_t expressions() const {
+        return results.size();
+    }
+
+    // distinct shapes among the added expressions
+    size_t shape_count() const {
+        return shapes.size();
+    }
+
+private:
+
+    struct shape {
+        std::vector<opcode> code;
+        std::vector<uint32_t> slots;
+        size_t constant_count;
+        // constants of every group of SHAPE_LANES members, one group after another
+        std::vector<T> constants;
+        std::vector<size_t> members;
+    };
+
+    std::vector<shape> shapes;
+    std::unordered_map<std::string, size_t> index;
+    std::vector<T> results;
+    std::vector<T> scratch;
+    std::vector<T> broadcast;
+    std::vector<const T*> operands;
+    std::string key;
+    size_t depth = 0;
+    size_t variable_count = 0;
+};
+
+// element-wise expression templates: combining columns and numbers with + - * / builds a tree type labelled
+// with special_char operators instead of computing anything, and assigning the tree runs a single loop that
+// evaluates the whole expression per element through apply_operator, so no intermediate vectors are made
+template <typename T>
+struct column_term {
+    using value_type = T;
+
+    std::span<const T> values;
+
+    T operator[](size_t i) const {
+        return values[i];
+    }
+
+    size_t size() const {
+        return values.size();
+    }
+};
+
+// number broadcast to every element
+template <typename T>
+struct scalar_term {
+    using value_type = T;
+
+    T value;
+
+    T operator[](size_t) const {
+        return value;
+    }
+
+    size_t size() const {
+        return SIZE_MAX;
+    }
+};
+
+template <special_char::type Op, typename L, typename R>
+struct binary_term {
+    using value_type = std::common_type_t<typename L::value_type, typename R::value_type>;
+
+    L lhs;
+    R rhs;
+
+    value_type operator[](size_t i) const {
+        return apply_operator<value_type>(Op, lhs[i], rhs[i]);
+    }
+
+    size_t size() const {
+        return std::min(lhs.size(), rhs.size());
+    }
+};
+
+template <typename E>
+struct is_term : std::false_type {};
+
+template <typename T>
+struct is_term<column_term<T>> : std::true_type {};
+
+template <typename T>
+struct is_term<scalar_term<T>> : std::true_type {};
+
+template <special_char::type Op, typename L, typename R>
+struct is_term<binary_term<Op, L, R>> : std::true_type {};
+
+template <typename E>
+concept term = is_term<std::remove_cvref_t<E>>::value;
+
+// at least one side is a term, the other may be a plain number
+template <typename L, typename R>
+concept term_operands = (term<L> && term<R>) || (term<L> && std::is_arithmetic_v<R>) || (std::is_arithmetic_v<L> && term<R>);
+
+template <typename T>
+column_term<T> column(std::span<const T> values) {
+    return {values};
+}
+
+template <typename T>
+column_term<T> column(const std::vector<T>& values) {
+    return {values};
+}
+
+template <typename E, typename Other>
+auto as_term(const E& operand) {
+    if constexpr (term<E>) {
+        return operand;
+    } else {
+        using value_type = typename Other::value_type;
+        return scalar_term<value_type>{static_cast<value_type>(operand)};
+    }
+}
+
+template <special_char::type Op, typename L, typename R>
+auto make_term(const L& lhs, const R& rhs) {
+    auto left = as_term<L, R>(lhs);
+    auto right = as_term<R, L>(rhs);
+    return binary_term<Op, decltype(left), decltype(right)>{left, right};
+}
+
+template <typename L, typename R> requires term_operands<L, R>
+auto operator+(const L& lhs, const R& rhs) {
+    return make_term<special_char::PLUS>(lhs, rhs);
+}
+
+template <typename L, typename R> requires term_operands<L, R>
+auto operator-(const L& lhs, const R& rhs) {
+    return make_term<special_char::MINUS>(lhs, rhs);
+}
+
+template <typename L, typename R> requires term_operands<L, R>
+auto operator*(const L& lhs, const R& rhs) {
+    return make_term<special_char::MULTIPLY>(lhs, rhs);
+}
+
+template <typename L, typename R> requires term_operands<L, R>
+auto operator/(const L& lhs, const R& rhs) {
+    return make_term<special_char::DIVIDE>(lhs, rhs);
+}
+
+// negation is a multiplication by -1, as the parser reads it
+template <term E>
+auto operator-(const E& operand) {
+    return make_term<special_char::MULTIPLY>(-1, operand);
+}
+
+// evaluates the tree into out, element by element in one loop
+template <typename T, term E>
+SIMD_TARGET_CLONES
+void assign(std::span<T> out, const E& expression) {
+    size_t size = std::min(out.size(), expression.size());
+    for (size_t i = 0; i < size; i++) {
+        out[i] = expression[i];
+    }
+}
+
+template <term E>
+std::vector<typename E::value_type> materialize(const E& expression) {
+    std::vector<typename E::value_type> out(expression.size());
+    assign(std::span<typename E::value_type>(out), expression);
+    return out;
+}
+
+// labels as values are a GCC and Clang extension
+#if defined(__GNUC__)
+#define COMPUTED_GOTO_AVAILABLE 1
+#else
+#define COMPUTED_GOTO_AVAILABLE 0
+#endif
+
+// stack interpreter over the same opcode stream with two dispatch strategies: direct threading, where every opcode
+// is resolved once to the address of its handler and each handler jumps straight to the next one, or a portable switch
+template <typename T, bool Threaded = COMPUTED_GOTO_AVAILABLE>
+class threaded_expression {
+public:
+
+    // a malformed program has no code and evaluates to T()
+    threaded_expression(const compiled_expression<T>& expression)
+        : program(expression.code()), pool(expression.constants()), slots(expression.variable_slots()),
+          values(expression.stack_depth() + 1) {
+        if (!expression.valid()) {
+            program.clear();
+        }
+        if constexpr (Threaded) {
+            run_threaded(nullptr, true);
+        }
+    }
+
+    T evaluate(const T* variables = nullptr) {
+        if constexpr (Threaded) {
+            return run_threaded(variables, false);
+        } else {
+            return run_switch(variables);
+        }
+    }
+
+private:
+
+    std::vector<opcode> program;
+    std::vector<T> pool;
+    std::vector<uint32_t> slots;
+    std::vector<T> values;
+    std::vector<const void*> handlers;
+
+    T run_switch(const T* variables) {
+        T* top = values.data();
+        const T* constant = pool.data();
+        const uint32_t* slot = slots.data();
+
+        for (opcode op : program) {
+            switch (op) {
+                case opcode::CONSTANT:
+                    *top++ = *constant++;
+                    break;
+                case opcode::VARIABLE:
+                    *top++ = variables[*slot++];
+                    break;
+                case opcode::PLUS:
+                    top--;
+                    top[-1] = top[-1] + top[0];
+                    break;
+                case opcode::MINUS:
+                    top--;
+                    top[-1] = top[-1] - top[0];
+                    break;
+                case opcode::MULTIPLY:
+                    top--;
+                    top[-1] = top[-1] * top[0];
+                    break;
+                case opcode::DIVIDE:
+                    top--;
+                    top[-1] = top[-1] / top[0];
+                    break;
+            }
+        }
+
+        return values[0];
+    }
+
+    // handler addresses only exist inside this function, so resolving the program happens here as well
+    T run_threaded(const T* variables, bool resolve) {
+#if COMPUTED_GOTO_AVAILABLE
+        static const void* const table[] = {&&constant_handler, &&variable_handler, &&plus_handler,
+                                            &&minus_handler, &&multiply_handler, &&divide_handler};
+        if (resolve) {
+            for (opcode op : program) {
+                handlers.push_back(table[static_cast<size_t>(op)]);
+            }
+            handlers.push_back(&&done);
+            return T();
+        }
+
+        T* top = values.data();
+        const T* constant = pool.data();
+        const uint32_t* slot = slots.data();
+        const void* const* next = handlers.data();
+
+        goto **next++;
+
+    constant_handler:
+        *top++ = *constant++;
+        goto **next++;
+    variable_handler:
+        *top++ = variables[*slot++];
+        goto **next++;
+    plus_handler:
+        top--;
+        top[-1] = top[-1] + top[0];
+        goto **next++;
+    minus_handler:
+        top--;
+        top[-1] = top[-1] - top[0];
+        goto **next++;
+    multiply_handler:
+        top--;
+        top[-1] = top[-1] * top[0];
+        goto **next++;
+    divide_handler:
+        top--;
+        top[-1] = top[-1] / top[0];
+        goto **next++;
+    done:
+        return values[0];
+#else
+        (void)resolve;
+        return run_switch(variables);
+#endif
+    }
+};
+
+// turns off contraction of a*b+c into a fused multiply-add for one function, which GCC otherwise does by default;
+// clang only contracts within one expression, so separate statements are enough there
+#if defined(__GNUC__) && !defined(__clang__)
+#define STRICT_ROUNDING __attribute__((optimize("fp-contract=off")))
+#else
+#define STRICT_ROUNDING
+#endif
+
+// register machine backend, constants, variables and temporaries share one frame so operands are plain slot numbers
+// and no instruction only moves a value; a multiplication or addition whose result feeds the next operation is fused
+// with it into a superinstruction
+template <typename T>
+class register_expression {
+public:
+
+    // contracting turns a*b+c, a*b-c and c-a*b into fused multiply-adds, rounded once instead of twice; only the fast
+    // math benchmark asks for it, --fast-math stops at reassociation, so no program a user runs is contracted
+    // a malformed program has no code and evaluates to T()
+    register_expression(const compiled_expression<T>& expression, bool contract_multiply_add = false)
+        : contract(contract_multiply_add) {
+        if (!expression.valid()) {
+            frame.assign(1, T());
+            return;
+        }
+
+        const auto& pool = expression.constants();
+        variables_begin = pool.size();
+        variable_count = expression.variables();
+        size_t registers_begin = variables_begin + expression.variables();
+        frame.assign(registers_begin + expression.stack_depth(), T());
+        std::copy(pool.begin(), pool.end(), frame.begin());
+
+        // symbolic evaluation of the postfix program, the stack holds frame slots instead of values
+        std::vector<uint32_t> stack;
+        size_t constant = 0;
+        const uint32_t* slot = expression.variable_slots().data();
+
+        for (opcode op : expression.code()) {
+            if (op == opcode::CONSTANT) {
+                stack.push_back(constant++);
+                continue;
+            }
+            if (op == opcode::VARIABLE) {
+                stack.push_back(variables_begin + *slot++);
+                continue;
+            }
+
+            uint32_t rhs = stack.back();
+            stack.pop_back();
+            uint32_t lhs = stack.back();
+            stack.pop_back();
+
+            // temporaries are numbered by stack height, so a register is free again as soon as its value is consumed
+            uint32_t destination = registers_begin + stack.size();
+            emit(op, destination, lhs, rhs);
+            stack.push_back(destination);
+        }
+
+        result = stack.empty() ? 0 : stack.back();
+    }
+
+    // the product of a superinstruction is rounded before it is added, whatever contraction the compiler would do
+    STRICT_ROUNDING T evaluate(const T* variables = nullptr) {
+        T* slots = frame.data();
+        if (variable_count > 0) {
+            std::copy(variables, variables + variable_count, slots + variables_begin);
+        }
+
+        T product{};
+        for (const auto& current : code) {
+            switch (current.op) {
+                case vm_opcode::PLUS:
+                    slots[current.destination] = slots[current.lhs] + slots[current.rhs];
+                    break;
+                case vm_opcode::MINUS:
+                    slots[current.destination] = slots[current.lhs] - slots[current.rhs];
+                    break;
+                case vm_opcode::MULTIPLY:
+                    slots[current.destination] = slots[current.lhs] * slots[current.rhs];
+                    break;
+                case vm_opcode::DIVIDE:
+                    slots[current.destination] = slots[current.lhs] / slots[current.rhs];
+                    break;
+                case vm_opcode::MULTIPLY_PLUS:
+                    product = slots[current.lhs] * slots[current.rhs];
+                    slots[current.destination] = product + slots[current.extra];
+                    break;
+                case vm_opcode::MULTIPLY_MINUS:
+                    product = slots[current.lhs] * slots[current.rhs];
+                    slots[current.destination] = product - slots[current.extra];
+                    break;
+                case vm_opcode::MINUS_MULTIPLY:
+                    product = slots[current.lhs] * slots[current.rhs];
+                    slots[current.destination] = slots[current.extra] - product;
+                    break;
+                case vm_opcode::PLUS_PLUS:
+                    slots[current.destination] = slots[current.lhs] + slots[current.rhs] + slots[current.extra];
+                    break;
+                case vm_opcode::FUSED_MULTIPLY_PLUS:
+                    slots[current.destination] = fused_multiply_add(slots[current.lhs], slots[current.rhs], slots[current.extra]);
+                    break;
+                case vm_opcode::FUSED_MULTIPLY_MINUS:
+                    slots[current.destination] = fused_multiply_add(slots[current.lhs], slots[current.rhs], -slots[current.extra]);
+                    break;
+                case vm_opcode::FUSED_MINUS_MULTIPLY:
+                    slots[current.destination] = fused_multiply_add(-slots[current.lhs], slots[current.rhs], slots[current.extra]);
+                    break;
+            }
+        }
+
+        return slots[result];
+    }
+
+    // instructions dispatched per evaluation
+    size_t instructions() const {
+        return code.size();
+    }
+
+private:
+
+    enum class vm_opcode : uint8_t {
+        PLUS,
+        MINUS,
+        MULTIPLY,
+        DIVIDE,
+        // lhs * rhs + extra
+        MULTIPLY_PLUS,
+        // lhs * rhs - extra
+        MULTIPLY_MINUS,
+        // extra - lhs * rhs
+        MINUS_MULTIPLY,
+        // lhs + rhs + extra
+        PLUS_PLUS,
+        // the three multiply-adds above with a single rounding, fast math only
+        FUSED_MULTIPLY_PLUS,
+        FUSED_MULTIPLY_MINUS,
+        FUSED_MINUS_MULTIPLY
+    };
+
+    struct instruction {
+        vm_opcode op;
+        uint32_t destination, lhs, rhs, extra;
+    };
+
+    std::vector<instruction> code;
+    std::vector<T> frame;
+    uint32_t variables_begin = 0;
+    uint32_t variable_count = 0;
+    uint32_t result = 0;
+    bool contract = false;
+
+    static T fused_multiply_add(const T& a, const T& b, const T& c) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return std::fma(a, b, c);
+        } else {
+            return a * b + c;
+        }
+    }
+
+    void emit(opcode op, uint32_t destination, uint32_t lhs, uint32_t rhs) {
+        // the previous instruction's temporary is used only here, so both can run as one
+        if (!code.empty() && (code.back().op == vm_opcode::MULTIPLY || code.back().op == vm_opcode::PLUS)) {
+            instruction& previous = code.back();
+            bool product = previous.op == vm_opcode::MULTIPLY;
+
+            if (product && op == opcode::PLUS && (previous.destination == lhs || previous.destination == rhs)) {
+                previous = {contract ? vm_opcode::FUSED_MULTIPLY_PLUS : vm_opcode::MULTIPLY_PLUS, destination, previous.lhs, previous.rhs, previous.destination == lhs ? rhs : lhs};
+                return;
+            }
+            if (product && op == opcode::MINUS && previous.destination == lhs) {
+                previous = {contract ? vm_opcode::FUSED_MULTIPLY_MINUS : vm_opcode::MULTIPLY_MINUS, destination, previous.lhs, previous.rhs, rhs};
+                return;
+            }
+            if (product && op == opcode::MINUS && previous.destination == rhs) {
+                previous = {contract ? vm_opcode::FUSED_MINUS_MULTIPLY : vm_opcode::MINUS_MULTIPLY, destination, previous.lhs, previous.rhs, lhs};
+                return;
+            }
+            if (!product && op == opcode::PLUS && previous.destination == lhs) {
+                previous = {vm_opcode::PLUS_PLUS, destination, previous.lhs, previous.rhs, rhs};
+                return;
+            }
+        }
+
+        vm_opcode base = op == opcode::PLUS ? vm_opcode::PLUS : op == opcode::MINUS ? vm_opcode::MINUS
+                       : op == opcode::MULTIPLY ? vm_opcode::MULTIPLY : vm_opcode::DIVIDE;
+        code.push_back({base, destination, lhs, rhs, 0});
+    }
+};
+
+// native code backend, only built for x86-64 System V targets
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_AVAILABLE 1
+#else
+#define JIT_AVAILABLE 0
+#endif
+
+// compiled expression translated to x86-64 scalar SSE code, stack slots live in xmm registers;
+// types other than float and double, and targets without the backend, use the interpreter instead
+template <typename T>
+class jit_expression {
+public:
+
+    jit_expression(const compiled_expression<T>& expression) : fallback(expression) {
+        if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+            if (JIT_AVAILABLE && expression.valid()) {
+                generate(expression);
+            }
+        }
+    }
+
+    jit_expression(const jit_expression&) = delete;
+    jit_expression& operator=(const jit_expression&) = delete;
+
+    ~jit_expression() {
+        release();
+    }
+
+    // true if evaluation runs native code rather than the interpreter
+    bool native() const {
+        return function != nullptr;
+    }
+
+    T evaluate(const T* variables = nullptr) {
+        if (function != nullptr) {
+            return function(constants.data(), variables, spills.data());
+        }
+        return fallback.evaluate(variables);
+    }
+
+private:
+
+    using native_function = T (*)(const T* constants, const T* variables, T* spills);
+
+    // xmm0..xmm13 hold the top of the stack, deeper slots spill to memory through xmm14 and xmm15
+    static constexpr size_t REGISTER_SLOTS = 14;
+    static constexpr uint8_t SCRATCH_LHS = 14, SCRATCH_RHS = 15;
+    static constexpr uint8_t RDX = 2, RSI = 6, RDI = 7;
+    static constexpr uint8_t LOAD = 0x10, STORE = 0x11, ADD = 0x58, MULTIPLY = 0x59, SUBTRACT = 0x5C, DIVIDE = 0x5E;
+
+    compiled_expression<T> fallback;
+    std::vector<T> constants;
+    std::vector<T> spills;
+    std::vector<uint8_t> code;
+    void* memory = nullptr;
+    size_t memory_size = 0;
+    native_function function = nullptr;
+
+    // movss/movsd/addss/... between two xmm registers
+    void emit_register(uint8_t opcode, uint8_t destination, uint8_t source) {
+        code.push_back(std::is_same_v<T, float> ? 0xF3 : 0xF2);
+        if (destination >= 8 || source >= 8) {
+            code.push_back(0x40 | (destination >= 8) << 2 | (source >= 8));
+        }
+        code.insert(code.end(), {0x0F, opcode, static_cast<uint8_t>(0xC0 | (destination & 7) << 3 | (source & 7))});
+    }
+
+    // the same instructions with a [base + disp32] memory operand
+    void emit_memory(uint8_t opcode, uint8_t xmm, uint8_t base, size_t slot) {
+        uint32_t displacement = static_cast<uint32_t>(slot * sizeof(T));
+        code.push_back(std::is_same_v<T, float> ? 0xF3 : 0xF2);
+        if (xmm >= 8) {
+            code.push_back(0x44);
+        }
+        code.insert(code.end(), {0x0F, opcode, static_cast<uint8_t>(0x80 | (xmm & 7) << 3 | base)});
+        for (int i = 0; i < 4; i++) {
+            code.push_back(static_cast<uint8_t>(displacement >> (8 * i)));
+        }
+    }
+
+    void emit_push(uint8_t base, size_t slot, size_t depth) {
+        if (depth < REGISTER_SLOTS) {
+            emit_memory(LOAD, depth, base, slot);
+        } else {
+            emit_memory(LOAD, SCRATCH_LHS, base, slot);
+            emit_memory(STORE, SCRATCH_LHS, RDX, depth);
+        }
+    }
+
+    void generate(const compiled_expression<T>& expression) {
+        size_t depth = 0, constant = 0;
+        const uint32_t* slot = expression.variable_slots().data();
+        constants = expression.constants();
+
+        for (opcode op : expression.code()) {
+            uint8_t instruction = 0;
+            switch (op) {
+                case opcode::CONSTANT:
+                    emit_push(RDI, constant++, depth++);
+                    continue;
+                case opcode::VARIABLE:
+                    emit_push(RSI, *slot++, depth++);
+                    continue;
+                case opcode::PLUS:
+                    instruction = ADD;
+                    break;
+                case opcode::MINUS:
+                    instruction = SUBTRACT;
+                    break;
+                case opcode::MULTIPLY:
+                    instruction = MULTIPLY;
+                    break;
+                case opcode::DIVIDE:
+                    instruction = DIVIDE;
+                    break;
+            }
+
+            size_t lhs = depth - 2, rhs = depth - 1;
+            depth--;
+            if (lhs < REGISTER_SLOTS) {
+                if (rhs < REGISTER_SLOTS) {
+                    emit_register(instruction, lhs, rhs);
+                } else {
+                    emit_memory(instruction, lhs, RDX, rhs);
+                }
+            } else {
+                emit_memory(LOAD, SCRATCH_LHS, RDX, lhs);
+                emit_memory(instruction, SCRATCH_LHS, RDX, rhs);
+                emit_memory(STORE, SCRATCH_LHS, RDX, lhs);
+            }
+        }
+
+        // the result is already in xmm0
+        code.push_back(0xC3);
+        spills.assign(expression.stack_depth() + 1, T());
+
+#if JIT_AVAILABLE
+        memory_size = code.size();
+        memory = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            memory = nullptr;
+            return;
+        }
+        std::memcpy(memory, code.data(), code.size());
+        if (mprotect(memory, memory_size, PROT_READ | PROT_EXEC) != 0) {
+            release();
+            return;
+        }
+        function = reinterpret_cast<native_function>(memory);
+#endif
+    }
+
+    void release() {
+#if JIT_AVAILABLE
+        if (memory != nullptr) {
+            munmap(memory, memory_size);
+        }
+#endif
+        memory = nullptr;
+        function = nullptr;
+    }
+};
+
+// ahead-of-time backend, needs dlopen and a system C++ compiler at run time
+#if defined(__unix__)
+#define AOT_AVAILABLE 1
+#else
+#define AOT_AVAILABLE 0
+#endif
+
+// 64-bit FNV-1a, names cached shared objects after the source they were built from
+constexpr uint64_t fnv1a(std::string_view text) {
+    uint64_t hash = 14695981039346656037u;
+    for (char c : text) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211u;
+    }
+    return hash;
+}
+
+// $CALCULATOR_CACHE, or the user's cache directory, or a directory under /tmp named after the user
+std::string default_cache_directory() {
+    if (const char* directory = std::getenv("CALCULATOR_CACHE")) {
+        return directory;
+    }
+    if (const char* directory = std::getenv("XDG_CACHE_HOME")) {
+        return std::string(directory) + "/calculator";
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::string(home) + "/.cache/calculator";
+    }
+#if AOT_AVAILABLE
+    return "/tmp/calculator-cache-" + std::to_string(geteuid());
+#else
+    return "/tmp/calculator-cache";
+#endif
+}
+
+// compiled expression emitted as C++, built into a shared object by the system compiler ($CXX, or c++) and loaded
+// with dlopen; objects are cached on disk by a hash of the generated source, which is the normalized expression,
+// so a formula is only rebuilt when it changes, and a source the compiler rejected is not tried again by the same
+// process; a cached object is only loaded when the source stored beside it is the generated source byte for byte,
+// since the hash alone can collide; the cache directory and every object loaded from it must belong to the user and be writable by no one
+// else, since anything planted there would run as the user; without a compiler, or for other T, the interpreter is used
+template <typename T>
+class native_expression {
+public:
+
+    native_expression(const compiled_expression<T>& expression, const std::string& cache_directory = default_cache_directory())
+        : fallback(expression) {
+        if (AOT_AVAILABLE && expression.valid() && !type_name().empty()) {
+            load(generate(expression), cache_directory);
+        }
+    }
+
+    native_expression(const native_expression&) = delete;
+    native_expression& operator=(const native_expression&) = delete;
+
+    ~native_expression() {
+#if AOT_AVAILABLE
+        if (library != nullptr) {
+            dlclose(library);
+        }
+#endif
+    }
+
+    // true if evaluation runs the compiled shared object rather than the interpreter
+    bool native() const {
+        return function != nullptr;
+    }
+
+    // true if the shared object had to be built rather than found in the cache
+    bool built() const {
+        return rebuilt;
+    }
+
+    T evaluate(const T* variables = nullptr) {
+        if (function != nullptr) {
+            return function(variables);
+        }
+        return fallback.evaluate(variables);
+    }
+
+private:
+
+    using native_function = T (*)(const T* variables);
+
+    compiled_expression<T> fallback;
+    void* library = nullptr;
+    native_function function = nullptr;
+    bool rebuilt = false;
+
+    static inline std::mutex failed_mutex;
+    static inline std::unordered_set<std::string> failed_sources;
+
+    static std::string type_name() {
+        if constexpr (std::is_same_v<T, float>) {
+            return "float";
+        } else if constexpr (std::is_same_v<T, double>) {
+            return "double";
+        } else if constexpr (std::is_same_v<T, int>) {
+            return "int";
+        } else if constexpr (std::is_same_v<T, long long>) {
+            return "long long";
+        } else {
+            return "";
+        }
+    }
+
+    // one statement per postfix operation on named stack slots, constants cast from exact hexadecimal floats, or
+    // from their bit pattern when they are infinite or NaN, which have no literal
+    static std::string generate(const compiled_expression<T>& expression) {
+        std::ostringstream source;
+        std::string type = type_name();
+        source << "extern \"C\" " << type << " calculator_evaluate(const " << type << "* v) {\n";
+        for (size_t slot = 0; slot < expression.stack_depth(); slot++) {
+            source << "    " << type << " s" << slot << ";\n";
+        }
+
+        size_t depth = 0, constant = 0;
+        const uint32_t* slot = expression.variable_slots().data();
+        for (opcode op : expression.code()) {
+            if (op == opcode::CONSTANT) {
+                source << "    s" << depth++ << " = static_cast<" << type << ">(";
+                if constexpr (std::is_floating_point_v<T>) {
+                    T value = expression.constants()[constant++];
+                    if (std::isfinite(value)) {
+                        source << std::hexfloat << static_cast<double>(value) << std::defaultfloat;
+                    } else if constexpr (sizeof(T) == sizeof(uint32_t)) {
+                        source << "__builtin_bit_cast(float, " << std::bit_cast<uint32_t>(value) << "u)";
+                    } else {
+                        source << "__builtin_bit_cast(double, " << std::bit_cast<uint64_t>(value) << "ull)";
+                    }
+                } else {
+                    source << expression.constants()[constant++];
+                }
+                source << ");\n";
+            } else if (op == opcode::VARIABLE) {
+                source << "    s" << depth++ << " = v[" << *slot++ << "];\n";
+            } else {
+                depth--;
+                source << "    s" << depth - 1 << " = s" << depth - 1 << " " << static_cast<char>(operator_of(op)) << " s" << depth << ";\n";
+            }
+        }
+
+        source << "    return s0;\n}\n";
+        return source.str();
+    }
+
+    void load(const std::string& source, const std::string& cache_directory) {
+#if AOT_AVAILABLE
+        uint64_t source_hash = fnv1a(source);
+        {
+            std::lock_guard<std::mutex> lock(failed_mutex);
+            if (failed_sources.contains(source)) {
+                return;
+            }
+        }
+
+        // only the last component is created here, private to the user
+        std::error_code error;
+        std::filesystem::path directory(cache_directory);
+        if (directory.has_parent_path()) {
+            std::filesystem::create_directories(directory.parent_path(), error);
+        }
+        mkdir(cache_directory.c_str(), 0700);
+        struct stat status;
+        if (stat(cache_directory.c_str(), &status) != 0 || !S_ISDIR(status.st_mode) || !owned_privately(status)) {
+            return;
+        }
+
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(source_hash));
+        std::string base = cache_directory + "/calc_" + hash;
+        std::string object = base + ".so";
+
+        if (!std::filesystem::exists(object)) {
+            // source and object are written under names private to the thread and renamed, so concurrent runs never
+            // compile a truncated source or load a half-written object
+            std::string temporary = base + "." + std::to_string(getpid()) + "."
+                                  + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+            std::ofstream(temporary + ".cpp") << source;
+
+            bool compiled = compile(temporary + ".cpp", temporary + ".so");
+            std::filesystem::rename(temporary + ".cpp", base + ".cpp", error);
+            if (!compiled) {
+                std::filesystem::remove(temporary + ".so", error);
+                std::lock_guard<std::mutex> lock(failed_mutex);
+                failed_sources.insert(source);
+                return;
+            }
+            std::filesystem::rename(temporary + ".so", object, error);
+            if (error) {
+                return;
+            }
+            rebuilt = true;
+        }
+
+        if (lstat(object.c_str(), &status) != 0 || !S_ISREG(status.st_mode) || !owned_privately(status)
+            || !stored_source_matches(base + ".cpp", source)) {
+            return;
+        }
+        library = dlopen(object.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (library != nullptr) {
+            function = reinterpret_cast<native_function>(dlsym(library, "calculator_evaluate"));
+        }
+#else
+        (void)source;
+        (void)cache_directory;
+#endif
+    }
+
+#if AOT_AVAILABLE
+    static bool owned_privately(const struct stat& status) {
+        return status.st_uid == geteuid() && (status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+    }
+
+    // false when the stored source is missing or is another formula whose source hashed to the same name
+    static bool stored_source_matches(const std::string& path, const std::string& source) {
+        std::ifstream stored(path, std::ios::binary);
+        std::string contents(source.size() + 1, '\0');
+        stored.read(contents.data(), contents.size());
+        return static_cast<size_t>(stored.gcount()) == source.size() && contents.compare(0, source.size(), source) == 0;
+    }
+
+    // runs the compiler on an argument vector rather than a shell command line, so no path is ever parsed by a shell;
+    // $CXX is split on whitespace, so it may name a wrapper or carry flags
+    static bool compile(const std::string& source_path, const std::string& object_path) {
+        std::vector<std::string> arguments;
+        const char* compiler = std::getenv("CXX");
+        std::istringstream words(compiler != nullptr ? compiler : "c++");
+        for (std::string word; words >> word;) {
+            arguments.push_back(word);
+        }
+        if (arguments.empty()) {
+            arguments.push_back("c++");
+        }
+        for (const char* flag : {"-O2", "-ffp-contract=off", "-shared", "-fPIC", "-o"}) {
+            arguments.push_back(flag);
+        }
+        arguments.push_back(object_path);
+        arguments.push_back(source_path);
+
+        std::vector<char*> argv;
+        for (auto& argument : arguments) {
+            argv.push_back(argument.data());
+        }
+        argv.push_back(nullptr);
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+        pid_t child;
+        int spawned = posix_spawnp(&child, argv[0], &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (spawned != 0) {
+            return false;
+        }
+
+        int status;
+        while (waitpid(child, &status, 0) < 0) {
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+#endif
+};
+
+// benchmarks, run with --bench
+template <typename Function>
+void benchmark(const std::string& name, size_t iterations, Function&& function, size_t operations_per_iteration = 1) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        function(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << elapsed.count() / (iterations * operations_per_iteration) << " ns/op\n";
+}
+
+const std::vector<std::string> BENCH_EXPRESSIONS = {
+    "1+2*3",
+    "(1.5+2.25)*(3-4.125)/2",
+    "-(2+3)*4-5/(6+7)",
+    "1+2+3+4+5+6+7+8+9+10+11+12+13+14+15+16",
+    "((((1+2)*3-4)/5+6)*7-8)/9",
+    "2(3+4)(5-6)-(7*8)/(9-10)+11.5*12.25"
+};
+
+// random fully parenthesized expression over the given variable names, for benchmark corpora
+std::string random_expression(std::mt19937& random, const std::vector<std::string>& names, int depth) {
+    std::uniform_int_distribution<int> percent(0, 99);
+    if (depth == 0 || percent(random) < 15) {
+        if (percent(random) < 50) {
+            return names[percent(random) % names.size()];
+        }
+        return std::to_string(percent(random) % 9 + 1) + "." + std::to_string(percent(random) % 10);
+    }
+
+    const char operators[] = "+-*/";
+    return "(" + random_expression(random, names, depth - 1) + operators[percent(random) % 4]
+         + random_expression(random, names, depth - 1) + ")";
+}
+
+// register machine against the stack interpreter on a generated corpus
+void bench_register_machine() {
+    volatile double sink = 0;
+    std::mt19937 random(42);
+    const std::vector<std::string> names = {"x", "y", "z"};
+    const double values[] = {1.25, -2.5, 3.75};
+
+    std::vector<compiled_expression<double>> stack_programs;
+    std::vector<register_expression<double>> register_programs;
+    size_t stack_dispatches = 0, register_dispatches = 0;
+    for (int i = 0; i < 1000; i++) {
+        variable_table table = names;
+        stack_programs.emplace_back(parse<double>(std::nullopt, random_expression(random, names, 6), &table));
+        register_programs.emplace_back(stack_programs.back());
+        stack_dispatches += stack_programs.back().code().size();
+        register_dispatches += register_programs.back().instructions();
+    }
+
+    std::cout << "generated corpus of " << stack_programs.size() << " expressions, " << stack_dispatches
+              << " stack instructions, " << register_dispatches << " register instructions\n";
+    const size_t rounds = 200;
+    benchmark("  stack interpreter", rounds, [&](size_t) {
+        for (auto& program : stack_programs) {
+            sink = program.evaluate(values);
+        }
+    }, stack_programs.size());
+    benchmark("  register machine", rounds, [&](size_t) {
+        for (auto& program : register_programs) {
+            sink = program.evaluate(values);
+        }
+    }, register_programs.size());
+}
+
+// switch dispatch against direct threading on long programs
+void bench_dispatch() {
+    volatile double sink = 0;
+    std::mt19937 random(7);
+    const std::vector<std::string> names = {"x", "y", "z"};
+    const double values[] = {1.25, -2.5, 3.75};
+
+    std::vector<threaded_expression<double, false>> switched;
+    std::vector<threaded_expression<double, true>> threaded;
+    size_t tokens = 0;
+    for (int i = 0; i < 100; i++) {
+        variable_table table = names;
+        compiled_expression<double> compiled(parse<double>(std::nullopt, random_expression(random, names, 12), &table));
+        switched.emplace_back(compiled);
+        threaded.emplace_back(compiled);
+        tokens += compiled.code().size();
+    }
+
+    std::cout << "dispatch over " << switched.size() << " generated programs, " << tokens / switched.size()
+              << " opcodes on average" << (COMPUTED_GOTO_AVAILABLE ? "" : ", computed goto unavailable") << "\n";
+    const size_t rounds = 200;
+    benchmark("  switch dispatch, per opcode", rounds, [&](size_t) {
+        for (auto& program : switched) {
+            sink = program.evaluate(values);
+        }
+    }, tokens);
+    benchmark("  direct threaded dispatch, per opcode", rounds, [&](size_t) {
+        for (auto& program : threaded) {
+            sink = program.evaluate(values);
+        }
+    }, tokens);
+}
+
+// shared objects built by the system compiler against the interpreter, in a scratch cache directory
+void bench_ahead_of_time() {
+    volatile double sink = 0;
+    std::string directory = (std::filesystem::temp_directory_path() / ("calculator-bench-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()))).string();
+    std::mt19937 random(11);
+    const std::vector<std::string> names = {"x", "y", "z"};
+    const double values[] = {1.25, -2.5, 3.75};
+
+    variable_table table = names;
+    compiled_expression<double> compiled(parse<double>(std::nullopt, random_expression(random, names, 9), &table));
+
+    std::cout << "ahead-of-time compiled expression, " << compiled.code().size() << " opcodes\n";
+    auto start = std::chrono::steady_clock::now();
+    native_expression<double> built(compiled, directory);
+    std::chrono::duration<double, std::milli> build_time = std::chrono::steady_clock::now() - start;
+    if (!built.native()) {
+        std::cout << "  no system compiler, using the interpreter\n";
+    }
+
+    start = std::chrono::steady_clock::now();
+    native_expression<double> cached(compiled, directory);
+    std::chrono::duration<double, std::milli> load_time = std::chrono::steady_clock::now() - start;
+    std::cout << "  first build: " << build_time.count() << " ms, cached load: " << load_time.count() << " ms"
+              << (cached.built() ? " (rebuilt)" : "") << "\n";
+
+    benchmark("  compiled evaluate", 100000, [&](size_t) {
+        sink = compiled.evaluate(values);
+    });
+    benchmark("  shared object evaluate", 100000, [&](size_t) {
+        sink = cached.evaluate(values);
+    });
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+}
+
+// vector with operators returning a new vector per operation, the baseline expression templates are measured against
+struct naive_column {
+    std::vector<float> values;
+};
+
+template <special_char::type Op>
+naive_column naive_apply(const naive_column& lhs, const naive_column& rhs) {
+    naive_column out{std::vector<float>(lhs.values.size())};
+    for (size_t i = 0; i < out.values.size(); i++) {
+        out.values[i] = apply_operator(Op, lhs.values[i], rhs.values[i]);
+    }
+    return out;
+}
+
+naive_column operator+(const naive_column& lhs, const naive_column& rhs) {
+    return naive_apply<special_char::PLUS>(lhs, rhs);
+}
+
+naive_column operator-(const naive_column& lhs, const naive_column& rhs) {
+    return naive_apply<special_char::MINUS>(lhs, rhs);
+}
+
+naive_column operator*(const naive_column& lhs, const naive_column& rhs) {
+    return naive_apply<special_char::MULTIPLY>(lhs, rhs);
+}
+
+naive_column operator/(const naive_column& lhs, const naive_column& rhs) {
+    return naive_apply<special_char::DIVIDE>(lhs, rhs);
+}
+
+// fused expression templates against per-operation temporaries and the column evaluator on the same formula
+void bench_expression_templates() {
+    volatile float sink = 0;
+    const size_t rows = 1 << 16;
+    std::vector<float> a(rows), b(rows), c(rows), d(rows), out(rows);
+    for (size_t i = 0; i < rows; i++) {
+        a[i] = 1.0f + i % 7;
+        b[i] = 2.0f + i % 5;
+        c[i] = 0.5f * (i % 3);
+        d[i] = 3.0f - i % 4;
+    }
+    naive_column na{a}, nb{b}, nc{c}, nd{d};
+
+    variable_table names = {"a", "b", "c", "d"};
+    compiled_expression<float> compiled(parse<float>(std::nullopt, "a*b+c*d-a/b", &names));
+    std::vector<const float*> columns = {a.data(), b.data(), c.data(), d.data()};
+
+    std::cout << "a*b+c*d-a/b over " << rows << " rows\n";
+    const size_t rounds = 200;
+    size_t allocations = allocation_count;
+    benchmark("  expression templates, per row", rounds, [&](size_t) {
+        assign(std::span<float>(out), column(a) * column(b) + column(c) * column(d) - column(a) / column(b));
+        sink = out[rows / 2];
+    }, rows);
+    std::cout << "  expression templates allocations per round: " << (allocation_count - allocations) / rounds << "\n";
+
+    allocations = allocation_count;
+    benchmark("  naive operators, per row", rounds, [&](size_t) {
+        naive_column result = na * nb + nc * nd - na / nb;
+        sink = result.values[rows / 2];
+    }, rows);
+    std::cout << "  naive operators allocations per round: " << (allocation_count - allocations) / rounds << "\n";
+
+    benchmark("  column evaluator, per row", rounds, [&](size_t) {
+        evaluate_columns(compiled, columns, rows, out.data());
+        sink = out[rows / 2];
+    }, rows);
+}
+
+// formulas as they are typed, with the negations, unit factors and constant subterms people write
+const std::vector<std::string> BENCH_FORMULAS = {
+    "(f-32)*5/9",
+    "p*(1+0.05/12)*(1+0.05/12)*(1+0.05/12)",
+    "-(x-1)*-(y+1)",
+    "a-(-(b))+c*1",
+    "(9.81*2)*h/1",
+    "4/3*3.14159265*r*r*r",
+    "m*(299792458*299792458)",
+    "-(-(v*v)/(2*9.81))",
+    "(1-0.2)*(1-0.15)*price+0*tax",
+    "x/(1+1)-(-y)/(2*2)"
+};
+
+// the optimization pass on written formulas: node counts and evaluation time before and after
+void bench_optimizer() {
+    volatile double sink = 0;
+    std::vector<compiled_expression<double>> original, optimized;
+    size_t before = 0, after = 0;
+    for (const auto& formula : BENCH_FORMULAS) {
+        variable_table names;
+        original.emplace_back(parse<double>(std::nullopt, formula, &names));
+        optimized.push_back(optimize(original.back()));
+        std::cout << formula << ": " << original.back().code().size() << " -> " << optimized.back().code().size() << " nodes\n";
+        before += original.back().code().size();
+        after += optimized.back().code().size();
+    }
+    for (const auto& expression : BENCH_EXPRESSIONS) {
+        original.emplace_back(parse<double>(std::nullopt, expression));
+        optimized.push_back(optimize(original.back()));
+        before += original.back().code().size();
+        after += optimized.back().code().size();
+    }
+
+    const double values[] = {1.25, -2.5, 3.75, 0.5};
+    std::cout << "optimizer on " << original.size() << " formulas, " << before << " -> " << after << " nodes\n";
+    const size_t rounds = 200000;
+    benchmark("  original, per formula", rounds, [&](size_t) {
+        for (auto& program : original) {
+            sink = program.evaluate(values);
+        }
+    }, original.size());
+    benchmark("  optimized, per formula", rounds, [&](size_t) {
+        for (auto& program : optimized) {
+            sink = program.evaluate(values);
+        }
+    }, optimized.size());
+}
+
+// fast math against strict evaluation: drift of the results and time on generated formulas, with multiply-adds
+// contracted by the register machine, which nothing outside this benchmark does, and a long sum rebalanced for the jit
+void bench_fast_math() {
+    volatile double sink = 0;
+    std::mt19937 random(5);
+    const std::vector<std::string> names = {"x", "y", "z"};
+    const double values[] = {1.25, -2.5, 3.75};
+
+    std::string chain;
+    for (int i = 1; i <= 64; i++) {
+        chain += (i > 1 ? "+" : "") + std::to_string(i) + ".5*" + names[i % 3];
+    }
+    std::vector<std::string> formulas = {chain};
+    for (int i = 0; i < 1000; i++) {
+        formulas.push_back(random_expression(random, names, 6));
+    }
+
+    std::vector<register_expression<double>> strict, fast;
+    double max_drift = 0, total_drift = 0;
+    size_t identical = 0, compared = 0;
+    for (const auto& formula : formulas) {
+        variable_table table = names;
+        compiled_expression<double> compiled(parse<double>(std::nullopt, formula, &table));
+        strict.emplace_back(compiled);
+        fast.emplace_back(optimize(compiled, true), true);
+
+        double expected = strict.back().evaluate(values), actual = fast.back().evaluate(values);
+        if (!std::isfinite(expected)) {
+            continue;
+        }
+        double drift = std::abs(actual - expected) / std::max(std::abs(expected), 1e-300);
+        max_drift = std::max(max_drift, drift);
+        total_drift += drift;
+        identical += actual == expected;
+        compared++;
+    }
+
+    std::cout << "fast math on " << formulas.size() << " formulas: " << identical << " of " << compared
+              << " finite results identical, relative drift mean " << total_drift / compared << ", max " << max_drift << "\n";
+    const size_t rounds = 200;
+    benchmark("  strict, per formula", rounds, [&](size_t) {
+        for (auto& program : strict) {
+            sink = program.evaluate(values);
+        }
+    }, strict.size());
+    benchmark("  fast math, per formula", rounds, [&](size_t) {
+        for (auto& program : fast) {
+            sink = program.evaluate(values);
+        }
+    }, fast.size());
+
+    // the balanced sum in native code, where its independent halves overlap in the pipeline
+    variable_table table = names;
+    compiled_expression<double> compiled(parse<double>(std::nullopt, chain, &table));
+    compiled_expression<double> balanced = optimize(compiled, true);
+    jit_expression<double> strict_native(compiled), fast_native(balanced);
+    std::cout << "64-term sum, stack depth " << compiled.stack_depth() << " strict, " << balanced.stack_depth()
+              << " balanced" << (strict_native.native() ? "" : ", no native code") << "\n";
+    benchmark("  strict jit", rounds * 1000, [&](size_t) {
+        sink = strict_native.evaluate(values);
+    });
+    benchmark("  fast math jit", rounds * 1000, [&](size_t) {
+        sink = fast_native.evaluate(values);
+    });
+}
+
+// a batch built from a library of shared subexpressions, as separate programs and as one hash-consed DAG
+void bench_dag() {
+    volatile double sink = 0;
+    std::mt19937 random(13);
+    const std::vector<std::string> names = {"x", "y", "z"};
+    const double values[] = {1.25, -2.5, 3.75};
+
+    std::vector<std::string> library;
+    for (int i = 0; i < 64; i++) {
+        library.push_back(random_expression(random, names, 4));
+    }
+
+    const char operators[] = "+-*/";
+    std::vector<compiled_expression<double>> programs;
+    expression_dag<double> dag;
+    size_t program_bytes = 0;
+    for (int i = 0; i < 20000; i++) {
+        std::string expression = library[random() % library.size()] + operators[random() % 4] + library[random() % library.size()]
+                               + operators[random() % 4] + library[random() % library.size()];
+        variable_table table = names;
+        programs.emplace_back(parse<double>(std::nullopt, expression, &table));
+        dag.add(programs.back());
+        program_bytes += programs.back().program_bytes();
+    }
+
+    std::cout << "batch of " << dag.expressions() << " expressions over " << library.size() << " shared subexpressions: "
+              << dag.tree_node_count() << " tree nodes in " << program_bytes << " bytes, " << dag.node_count()
+              << " dag nodes in " << dag.bytes() << " bytes\n";
+    const size_t rounds = 20;
+    benchmark("  separate programs, per expression", rounds, [&](size_t) {
+        for (auto& program : programs) {
+            sink = program.evaluate(values);
+        }
+    }, programs.size());
+    benchmark("  shared dag, per expression", rounds, [&](size_t) {
+        dag.evaluate(values);
+        for (size_t i = 0; i < dag.expressions(); i++) {
+            sink = dag.result(i);
+        }
+    }, dag.expressions());
+}
+
+// shape grouping against one program per expression on a batch of few shapes with different constants
+void bench_shapes() {
+    volatile double sink = 0;
+    std::mt19937 random(29);
+    std::uniform_int_distribution<int> digit(1, 9);
+    const std::vector<std::string> names = {"x", "y", "z"};
+    const double values[] = {1.25, -2.5, 3.75};
+
+    std::vector<std::string> templates;
+    for (int i = 0; i < 32; i++) {
+        templates.push_back(random_expression(random, names, 4));
+    }
+
+    // every number of a template gets fresh digits, so no two expressions are alike
+    std::vector<compiled_expression<double>> programs;
+    shape_batch<double> batch;
+    for (int i = 0; i < 20000; i++) {
+        std::string expression = templates[random() % templates.size()];
+        for (char& c : expression) {
+            if (is_digit(c)) {
+                c = static_cast<char>('0' + digit(random));
+            }
+        }
+        variable_table table = names;
+        programs.emplace_back(parse<double>(std::nullopt, expression, &table));
+        batch.add(programs.back());
+    }
+
+    std::cout << "batch of " << batch.expressions() << " expressions in " << batch.shape_count() << " shapes, "
+              << SHAPE_LANES << " lanes\n";
+    const size_t rounds = 50;
+    benchmark("  separate programs, per expression", rounds, [&](size_t) {
+        for (auto& program : programs) {
+            sink = program.evaluate(values);
+        }
+    }, programs.size());
+    benchmark("  grouped by shape, per expression", rounds, [&](size_t) {
+        batch.evaluate(values);
+        for (size_t i = 0; i < batch.expressions(); i++) {
+            sink = batch.result(i);
+        }
+    }, batch.expressions());
+}
+
+// big_integer multiplication algorithms, division and decimal conversion from 64-bit operands to millions of digits
+void bench_big_integer() {
+    std::mt19937 random(31);
+    auto random_number = [&](size_t digits) {
+        std::string text(1, static_cast<char>('1' + random() % 9));
+        while (text.size() < digits) {
+            text += static_cast<char>('0' + random() % 10);
+        }
+        return big_integer::from_string(text);
+    };
+
+    const std::pair<multiplication, const char*> methods[] = {
+        {multiplication::schoolbook, "schoolbook"}, {multiplication::karatsuba, "karatsuba"},
+        {multiplication::toom3, "toom-3"}, {multiplication::ntt, "ntt"}, {multiplication::automatic, "automatic"}};
+
+    volatile size_t sink = 0;
+    for (size_t digits : {20, 100, 1000, 10000, 100000, 1000000, 4000000}) {
+        big_integer a = random_number(digits), b = random_number(digits);
+        size_t iterations = std::max<size_t>(1, 100000 / digits);
+        std::cout << digits << "-digit operands, " << a.bits() << " bits\n";
+
+        // the quadratic and the older subquadratic algorithms are left out once they would take seconds
+        for (const auto& [method, name] : methods) {
+            size_t limit = method == multiplication::schoolbook ? 100000
+                         : method == multiplication::karatsuba || method == multiplication::toom3 ? 1000000 : SIZE_MAX;
+            if (digits > limit || (method == multiplication::ntt && digits < 1000)) {
+                continue;
+            }
+            benchmark("  multiply, " + std::string(name), iterations, [&](size_t) {
+                sink = big_integer::multiply(a, b, method).bits();
+            });
+        }
+        if (digits > 1000000) {
+            continue;
+        }
+
+        big_integer product = a * b + random_number(digits / 2);
+        benchmark("  divide 2n by n digits", iterations, [&](size_t) {
+            sink = (product / b).bits();
+        });
+        std::string text;
+        benchmark("  to decimal", iterations, [&](size_t) {
+            text = a.to_string();
+        });
+        benchmark("  from decimal", iterations, [&](size_t) {
+            sink = big_integer::from_string(text).bits();
+        });
+    }
+}
+
+// fork-join tree evaluation against the stack walk on one large generated formula
+void bench_fork_join() {
+    volatile double sink = 0;
+    std::mt19937 random(23);
+    const std::vector<std::string> names = {"x", "y", "z"};
+    const double values[] = {1.25, -2.5, 3.75};
+
+    variable_table table = names;
+    compiled_expression<double> program(parse<double>(std::nullopt, random_expression(random, names, 26), &table));
+    expression_tree<double> tree(program);
+
+    std::cout << "formula of " << tree.size() << " nodes, " << std::thread::hardware_concurrency() << " cores\n";
+    const size_t rounds = 20;
+    benchmark("  stack walk, per node", rounds, [&](size_t) {
+        sink = program.evaluate(values);
+    }, tree.size());
+    benchmark("  tree, one pass, per node", rounds, [&](size_t) {
+        sink = tree.evaluate(values);
+    }, tree.size());
+    for (size_t threads : {size_t(1), size_t(2), size_t(std::max(1u, std::thread::hardware_concurrency()))}) {
+        work_stealing_pool pool(threads);
+        benchmark("  fork-join, " + std::to_string(threads) + " threads, per node", rounds, [&](size_t) {
+            sink = tree.evaluate(pool, values);
+        }, tree.size());
+    }
+}
+
+// structural indexing against the byte loop on a machine-generated expression of several megabytes
+void bench_structural_index() {
+    std::mt19937 random(17);
+    std::uniform_int_distribution<int> digits(1, 12), digit(0, 9), operation(0, 3);
+    std::string expression;
+    while (expression.size() < (8 << 20)) {
+        expression += "(";
+        for (int term = 0; term < 4; term++) {
+            for (int i = digits(random); i > 0; i--) {
+                expression += static_cast<char>('0' + digit(random));
+            }
+            expression += ".";
+            for (int i = digits(random); i > 0; i--) {
+                expression += static_cast<char>('0' + digit(random));
+            }
+            expression += "+-*/"[operation(random)];
+        }
+        expression += "1)*";
+    }
+    expression += "1";
+
+    auto throughput = [&](const std::string& name, auto&& scan) {
+        const size_t rounds = 5;
+        size_t tokens = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; i++) {
+            tokens = scan();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << rounds * expression.size() / elapsed.count() / 1e9 << " GB/s, " << tokens << " tokens\n";
+    };
+
+    std::cout << "tokenizing " << expression.size() << " bytes\n";
+    throughput("  byte loop", [&]() {
+        size_t tokens = 0;
+        tokenize<double>(std::nullopt, expression, [&](const token<double>&) { tokens++; }, nullptr, scan_mode::bytewise);
+        return tokens;
+    });
+    throughput("  structural index", [&]() {
+        size_t tokens = 0;
+        tokenize<double>(std::nullopt, expression, [&](const token<double>&) { tokens++; }, nullptr, scan_mode::indexed);
+        return tokens;
+    });
+    throughput("  structural masks only", [&]() {
+        uint64_t masks[64];
+        size_t structurals = 0;
+        for (size_t block = 0; block + 64 <= expression.size() / STRUCTURAL_BLOCK; block += 64) {
+            structural_masks()(expression.data() + block * STRUCTURAL_BLOCK, 64, masks);
+            for (uint64_t mask : masks) {
+                structurals += std::popcount(mask);
+            }
+        }
+        return structurals;
+    });
+}
+
+// literal conversion throughput: the stream extraction generic T uses, std::from_chars, and parse_number
+void bench_number_parsing() {
+    std::mt19937_64 random(19);
+    std::vector<std::string> literals;
+    size_t bytes = 0;
+    for (int i = 0; i < 200000; i++) {
+        char text[64];
+        double value = std::ldexp(static_cast<double>(random() >> 11), static_cast<int>(random() % 200) - 100 - 53);
+        std::snprintf(text, sizeof(text), i % 2 ? "%.17g" : "%.6f", value);
+        literals.emplace_back(text);
+        bytes += literals.back().size();
+    }
+
+    auto throughput = [&](const std::string& name, auto&& convert) {
+        const size_t rounds = 5;
+        double checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; round++) {
+            for (const auto& literal : literals) {
+                checksum += convert(literal);
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << rounds * bytes / elapsed.count() / 1e6 << " MB/s (checksum " << checksum << ")\n";
+    };
+
+    std::cout << "converting " << literals.size() << " literals, " << bytes << " bytes\n";
+    throughput("  istringstream double", [](const std::string& literal) {
+        double value = 0;
+        std::istringstream(literal) >> value;
+        return value;
+    });
+    throughput("  from_chars double", [](const std::string& literal) {
+        double value = 0;
+        std::from_chars(literal.data(), literal.data() + literal.size(), value);
+        return value;
+    });
+    throughput("  parse_number double", [](const std::string& literal) {
+        return parse_number<double>(literal);
+    });
+    throughput("  from_chars float", [](const std::string& literal) {
+        float value = 0;
+        std::from_chars(literal.data(), literal.data() + literal.size(), value);
+        return static_cast<double>(value);
+    });
+    throughput("  parse_number float", [](const std::string& literal) {
+        return static_cast<double>(parse_number<float>(literal));
+    });
+}
+
+void bench_parallel() {
+    std::mt19937 random(19);
+    std::uniform_int_distribution<int> digits(1, 6), digit(0, 9), factors(1, 4), sign(0, 1);
+    auto number = [&]() {
+        std::string text;
+        for (int i = digits(random); i > 0; i--) {
+            text += static_cast<char>('0' + digit(random));
+        }
+        return text + "." + static_cast<char>('0' + digit(random));
+    };
+    std::string expression = number();
+    while (expression.size() < (32 << 20)) {
+        expression += sign(random) ? "+" : "-";
+        expression += number();
+        for (int i = factors(random); i > 1; i--) {
+            expression += i % 2 ? "*" + number() : "*(" + number() + "-" + number() + ")";
+        }
+    }
+
+    auto throughput = [&](const std::string& name, auto&& evaluate) {
+        auto start = std::chrono::steady_clock::now();
+        double result = evaluate().value_or(NAN);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << name << ": " << expression.size() / elapsed.count() / 1e6 << " MB/s, result " << result;
+        return result;
+    };
+
+    std::cout << "evaluating " << expression.size() << " bytes, " << std::thread::hardware_concurrency() << " cores\n";
+    double sequential = throughput("  sequential", [&]() {
+        reducing_evaluator<double, growing_stack> evaluator;
+        tokenize<double>(std::nullopt, expression, evaluator);
+        return evaluator.finish();
+    });
+    std::cout << "\n";
+    for (size_t threads : {size_t(1), size_t(2), size_t(std::max(1u, std::thread::hardware_concurrency()))}) {
+        double result = throughput("  parallel, " + std::to_string(threads) + " threads",
+                                   [&]() { return evaluate_parallel<double>(expression, threads); });
+        std::cout << ", off by " << result - sequential << "\n";
+    }
+}
+
+void run_benchmarks() {
+    volatile float sink = 0;
+    const size_t iterations = 1000000;
+
+    for (const auto& expression : BENCH_EXPRESSIONS) {
+        std::cout << expression << "\n";
+
+        benchmark("  parse + evaluate", iterations, [&](size_t) {
+            sink = evaluate<float>(parse<float>(std::nullopt, expression)).value();
+        });
+
+        std::vector<token<float>> tokens;
+        benchmark("  parse", iterations, [&](size_t) {
+            parse<float>(std::nullopt, expression, tokens);
+        });
+
+        benchmark("  evaluate", iterations, [&](size_t) {
+            sink = evaluate<float>(tokens).value();
+        });
+
+        benchmark("  one-pass evaluate", iterations, [&](size_t) {
+            sink = evaluate_line<float>(std::nullopt, expression).value();
+        });
+
+        compiled_expression<float> compiled(tokens);
+        std::cout << "  program size: " << compiled.code().size() * sizeof(token<float>) << " bytes as tokens, "
+                  << compiled.program_bytes() << " bytes as opcodes and constants ("
+                  << static_cast<double>(compiled.program_bytes()) / compiled.code().size() << " per token)\n";
+        benchmark("  compiled evaluate", iterations, [&](size_t) {
+            sink = compiled.evaluate();
+        });
+    }
+
+    // heap allocations per expression once buffers have grown
+    auto allocations_per_expression = [&](auto&& function) {
+        function();
+        size_t before = allocation_count;
+        for (int i = 0; i < 1000; i++) {
+            function();
+        }
+        return (allocation_count - before) / (1000.0 * BENCH_EXPRESSIONS.size());
+    };
+    scratch_arena<float> arena;
+    std::cout << "allocations per expression\n";
+    std::cout << "  parse + evaluate: " << allocations_per_expression([&]() {
+        for (const auto& expression : BENCH_EXPRESSIONS) {
+            sink = evaluate<float>(parse<float>(std::nullopt, expression)).value();
+        }
+    }) << "\n";
+    std::cout << "  one-pass evaluate: " << allocations_per_expression([&]() {
+        for (const auto& expression : BENCH_EXPRESSIONS) {
+            sink = evaluate_line<float>(std::nullopt, expression).value();
+        }
+    }) << "\n";
+    std::cout << "  scratch arena evaluate: " << allocations_per_expression([&]() {
+        for (const auto& expression : BENCH_EXPRESSIONS) {
+            sink = evaluate<float>(expression, arena).value();
+        }
+    }) << "\n";
+
+    // one formula over many rows
+    const size_t rows = 1 << 22;
+    variable_table names;
+    compiled_expression<float> pricing(parse<float>(std::nullopt, "price*(1+rate)-fee/qty+(price-cost)*0.25", &names));
+    std::vector<std::vector<float>> data(names.size(), std::vector<float>(rows));
+    for (size_t v = 0; v < names.size(); v++) {
+        for (size_t row = 0; row < rows; row++) {
+            data[v][row] = 1.0f + (row * (v + 3) % 97) / 8.0f;
+        }
+    }
+    std::vector<const float*> columns;
+    for (const auto& column : data) {
+        columns.push_back(column.data());
+    }
+    std::vector<float> results(rows), row_values(names.size());
+
+    std::cout << "price*(1+rate)-fee/qty+(price-cost)*0.25 over " << rows << " rows\n";
+    benchmark("  compiled evaluate per row", rows, [&](size_t row) {
+        for (size_t v = 0; v < names.size(); v++) {
+            row_values[v] = data[v][row];
+        }
+        results[row] = pricing.evaluate(row_values.data());
+    });
+    sink = results[rows / 2];
+    benchmark("  column evaluate", 1, [&](size_t) {
+        evaluate_columns(pricing, columns, rows, results.data());
+    }, rows);
+    sink = results[rows / 2];
+
+    // formulas known at compile time
+    constexpr float folded = "(1.5+2.25)*(3-4.125)/2"_expr;
+    constexpr auto margin = "price*(1+rate)-fee/qty+(price-cost)*0.25"_expr;
+    std::cout << "(1.5+2.25)*(3-4.125)/2 folded to " << folded << " at compile time\n";
+    std::cout << "price*(1+rate)-fee/qty+(price-cost)*0.25\n";
+    benchmark("  compiled evaluate", iterations, [&](size_t i) {
+        row_values[0] = i;
+        sink = pricing.evaluate(row_values.data());
+    });
+    benchmark("  fixed formula evaluate", iterations, [&](size_t i) {
+        sink = margin(i, row_values[1], row_values[2], row_values[3], row_values[4]);
+    });
+
+    // native code against the interpreter on deep and wide expressions
+    std::string deep, wide;
+    for (int i = 1; i <= 64; i++) {
+        deep += std::to_string(i) + (i % 2 ? "+(" : "*(");
+    }
+    deep += "1" + std::string(64, ')');
+    for (int i = 1; i <= 256; i++) {
+        wide += (i > 1 ? "+" : "") + std::to_string(i) + "*x/" + std::to_string(i + 1);
+    }
+
+    for (const auto& [name, expression] : {std::pair{"deep", deep}, std::pair{"wide", wide}}) {
+        variable_table jit_names;
+        compiled_expression<double> interpreted(parse<double>(std::nullopt, expression, &jit_names));
+        jit_expression<double> native(interpreted);
+        std::vector<double> x(jit_names.size(), 1.5);
+
+        std::cout << name << " expression, " << interpreted.code().size() << " tokens, stack depth "
+                  << interpreted.stack_depth() << (native.native() ? "" : ", no native code") << "\n";
+        benchmark("  compiled evaluate", iterations / 10, [&](size_t) {
+            sink = interpreted.evaluate(x.data());
+        });
+        benchmark("  jit evaluate", iterations / 10, [&](size_t) {
+            sink = native.evaluate(x.data());
+        });
+    }
+
+    bench_register_machine();
+    bench_dispatch();
+    bench_ahead_of_time();
+    bench_expression_templates();
+    bench_optimizer();
+    bench_fast_math();
+    bench_dag();
+    bench_shapes();
+    bench_fork_join();
+    bench_structural_index();
+    bench_number_parsing();
+    bench_parallel();
+    bench_big_integer();
+
+    (void)sink;
+}
+
+// bounded least-recently-used memo of expression results, limited by the approximate bytes its entries occupy
+template <typename T>
+class result_cache {
+public:
+
+    result_cache(size_t capacity_bytes) : capacity(capacity_bytes) {}
+
+    // cached result for key, or nullptr; a hit makes the entry the most recently used one
+    const std::optional<T>* find(const std::string& key) {
+        auto found = index.find(key);
+        if (found == index.end()) {
+            miss_count++;
+            return nullptr;
+        }
+
+        hit_count++;
+        entries.splice(entries.begin(), entries, found->second);
+        return &found->second->second;
+    }
+
+    void insert(const std::string& key, const std::optional<T>& result) {
+        if (entry_bytes(key) > capacity || index.count(key) != 0) {
+            return;
+        }
+
+        entries.emplace_front(key, result);
+        index.emplace(entries.front().first, entries.begin());
+        used += entry_bytes(key);
+
+        while (used > capacity) {
+            used -= entry_bytes(entries.back().first);
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const result_cache& cache) {
+        size_t lookups = cache.hit_count + cache.miss_count;
+        out << cache.entries.size() << " entries, " << cache.used << " of " << cache.capacity << " bytes, "
+            << cache.hit_count << " hits, " << cache.miss_count << " misses, hit rate "
+            << (lookups > 0 ? 100.0 * cache.hit_count / lookups : 0.0) << "%";
+        return out;
+    }
+
+    // bytes an entry takes from the budget: key characters, the list node and the hash table node
+    static size_t entry_bytes(const std::string& key) {
+        return key.size() + sizeof(entry) + 2 * sizeof(void*) + sizeof(std::string_view) + 3 * sizeof(void*);
+    }
+
+private:
+
+    using entry = std::pair<std::string, std::optional<T>>;
+
+    // most recently used first, the index refers to the keys stored in the list
+    std::list<entry> entries;
+    std::unordered_map<std::string_view, typename std::list<entry>::iterator> index;
+    size_t capacity;
+    size_t used = 0;
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+};
+
+// cache key of a REPL line, the whitespace-stripped input followed by the bytes of the carried result when the input
+// uses it, so a line that starts a new expression hits whatever result came before
+template <typename T>
+void make_cache_key(std::string& key, const std::string& input, const std::optional<token<T>>& previous_result) {
+    key.assign(input);
+    if (previous_result.has_value() && continues_previous_result(input)) {
+        T value = std::get<T>(previous_result.value());
+        key += '\0';
+        key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+}
+
+// single background thread running jobs in submission order, so callers never wait for a compiler
+class background_worker {
+public:
+
+    background_worker() : thread([this]() { run(); }) {}
+
+    background_worker(const background_worker&) = delete;
+    background_worker& operator=(const background_worker&) = delete;
+
+    ~background_worker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_one();
+        thread.join();
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        condition.notify_one();
+    }
+
+private:
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+    std::thread thread;
+
+    void run() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+// tiered execution: an expression starts on the one-pass evaluator, moves to a cached compiled program after
+// compile_threshold evaluations and to native code after native_threshold; programs are optimized and built on the
+// background worker and picked up on a later evaluation, and the carried previous result is variable slot 0; with
+// fast math a cold expression runs its optimized program too, so its value does not change when it is promoted
+template <typename T>
+class tiered_engine {
+public:
+
+    static constexpr size_t TIERS = 3;
+
+    tiered_engine(background_worker& compiler, size_t compile_threshold, size_t native_threshold, bool fast_math = false)
+        : compiler(compiler), compile_threshold(compile_threshold), native_threshold(native_threshold),
+          fast_math(fast_math), finished(std::make_shared<mailbox>()) {}
+
+    // input must already be stripped of whitespace; nullopt for a malformed expression
+    std::optional<T> evaluate(const std::optional<token<T>>& previous_result, const std::string& input) {
+        auto found = count_hit(previous_result, input);
+        entry& current = found->second;
+
+        T previous = previous_result.has_value() ? std::get<T>(previous_result.value()) : T();
+        auto start = std::chrono::steady_clock::now();
+        std::optional<T> result;
+        switch (current.tier) {
+            case 2:
+                result = current.native->evaluate(&previous);
+                break;
+            case 1:
+                result = current.compiled->evaluate(&previous);
+                break;
+            default:
+                if (fast_math) {
+                    // reassociation changes rounding, so a cold line runs the program it is promoted with
+                    compiled_expression<T> program = build(found->first, fast_math);
+                    result = program.valid() ? std::make_optional(program.evaluate(&previous)) : std::nullopt;
+                } else {
+                    result = evaluate_line<T>(previous_result, input);
+                }
+                current.malformed = !result.has_value();
+                break;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        current.seconds[current.tier] += elapsed.count();
+        current.runs[current.tier]++;
+
+        promote_if_hot(found);
+        return result;
+    }
+
+    // counts a line answered without evaluating it, by the REPL's result cache, so a hot line still moves up the
+    // tiers and runs compiled once the cache misses it, after eviction or with a different carried result
+    void record_hit(const std::optional<token<T>>& previous_result, const std::string& input, bool malformed) {
+        auto found = count_hit(previous_result, input);
+        found->second.malformed = malformed;
+        promote_if_hot(found);
+    }
+
+    // distinct expressions and time spent at each tier
+    std::array<std::pair<size_t, double>, TIERS> summary() const {
+        std::array<std::pair<size_t, double>, TIERS> totals{};
+        for (const auto& [name, current] : entries) {
+            totals[current.tier].first++;
+            for (size_t tier = 0; tier < TIERS; tier++) {
+                totals[tier].second += current.seconds[tier];
+            }
+        }
+        return totals;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, const tiered_engine& engine) {
+        for (const auto& [name, current] : engine.entries) {
+            out << (name.back() == '\1' ? "_ " : "") << std::string_view(name).substr(0, name.size() - 1)
+                << ": tier " << current.tier << ", " << current.hits << " hits";
+            for (size_t tier = 0; tier < TIERS; tier++) {
+                if (current.runs[tier] > 0) {
+                    out << ", tier " << tier << " " << current.seconds[tier] * 1e6 << " us";
+                }
+            }
+            out << "\n";
+        }
+
+        auto totals = engine.summary();
+        for (size_t tier = 0; tier < TIERS; tier++) {
+            out << "tier " << tier << ": " << totals[tier].first << " expressions, " << totals[tier].second * 1e6 << " us\n";
+        }
+        return out;
+    }
+
+private:
+
+    struct entry {
+        size_t hits = 0;
+        size_t tier = 0;
+        bool pending = false;
+        bool malformed = false;
+        bool no_native = false;
+        std::array<double, TIERS> seconds{};
+        std::array<size_t, TIERS> runs{};
+        std::unique_ptr<compiled_expression<T>> compiled;
+        std::unique_ptr<jit_expression<T>> native;
+    };
+
+    // programs built on the background worker, shared so jobs may outlive the engine
+    struct mailbox {
+        std::mutex mutex;
+        std::atomic<bool> ready{false};
+        std::vector<std::tuple<std::string, std::unique_ptr<compiled_expression<T>>, std::unique_ptr<jit_expression<T>>>> programs;
+    };
+
+    background_worker& compiler;
+    size_t compile_threshold;
+    size_t native_threshold;
+    bool fast_math;
+    std::shared_ptr<mailbox> finished;
+    std::unordered_map<std::string, entry> entries;
+    size_t entry_limit = 1 << 16;
+    std::string key;
+
+    // entry of an input, created on first sight, with one more hit; the carried result is part of the key only when
+    // the input uses it
+    typename std::unordered_map<std::string, entry>::iterator count_hit(const std::optional<token<T>>& previous_result,
+                                                                        const std::string& input) {
+        if (finished->ready.load(std::memory_order_acquire)) {
+            collect();
+        }
+
+        key.assign(input);
+        key += previous_result.has_value() && continues_previous_result(input) ? '\1' : '\0';
+        auto found = entries.find(key);
+        if (found == entries.end()) {
+            if (entries.size() >= entry_limit) {
+                sweep();
+            }
+            found = entries.emplace(key, entry()).first;
+        }
+        found->second.hits++;
+        return found;
+    }
+
+    void promote_if_hot(typename std::unordered_map<std::string, entry>::iterator found) {
+        entry& current = found->second;
+        if (!current.malformed && !current.pending) {
+            if (current.tier == 0 && current.hits >= compile_threshold) {
+                promote(found->first, 1);
+            } else if (current.tier == 1 && current.hits >= native_threshold && !current.no_native) {
+                promote(found->first, 2);
+            }
+        }
+    }
+
+    // forget expressions that never got past the interpreter, so a stream of distinct inputs stays bounded
+    void sweep() {
+        std::erase_if(entries, [](const auto& item) { return item.second.tier == 0 && !item.second.pending; });
+        if (entries.size() >= entry_limit / 2) {
+            entry_limit *= 2;
+        }
+    }
+
+    // optimized program of an entry, reading the carried result from variable slot 0 when its name says it uses it
+    static compiled_expression<T> build(const std::string& name, bool fast_math) {
+        std::optional<token<T>> previous;
+        if (name.back() == '\1') {
+            previous = variable{0};
+        }
+        return optimize(compiled_expression<T>(parse<T>(previous, std::string_view(name).substr(0, name.size() - 1))), fast_math);
+    }
+
+    void promote(const std::string& name, size_t tier) {
+        entries[name].pending = true;
+        compiler.submit([name, tier, fast_math = fast_math, finished = finished]() {
+            auto compiled = std::make_unique<compiled_expression<T>>(build(name, fast_math));
+
+            std::unique_ptr<jit_expression<T>> native;
+            if (tier == 2) {
+                native = std::make_unique<jit_expression<T>>(*compiled);
+                compiled.reset();
+            }
+
+            std::lock_guard<std::mutex> lock(finished->mutex);
+            finished->programs.emplace_back(name, std::move(compiled), std::move(native));
+            finished->ready.store(true, std::memory_order_release);
+        });
+    }
+
+    void collect() {
+        std::lock_guard<std::mutex> lock(finished->mutex);
+        for (auto& [name, compiled, native] : finished->programs) {
+            entry& current = entries[name];
+            current.pending = false;
+            if (compiled != nullptr) {
+                current.compiled = std::move(compiled);
+                current.tier = 1;
+            } else if (native->native()) {
+                current.native = std::move(native);
+                current.tier = 2;
+            } else {
+                current.no_native = true;
+            }
+        }
+        finished->programs.clear();
+        finished->ready.store(false, std::memory_order_release);
+    }
+};
+
+// batch mode, evaluates every line of a file as an independent expression and prints results in input order
+int run_batch(const std::string& path, size_t threads, std::optional<std::pair<size_t, size_t>> tier_thresholds, bool fast_math,
+              bool shared_dag, bool grouped_shapes, bool exact_integers, bool native_code) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "cannot open " << path << "\n";
+        return 1;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::vector<std::string_view> lines;
+    std::string_view rest = contents;
+    while (!rest.empty()) {
+        size_t end = rest.find('\n');
+        lines.push_back(rest.substr(0, end));
+        rest = (end == std::string_view::npos) ? std::string_view() : rest.substr(end + 1);
+    }
+
+    // each worker owns a contiguous range of lines, so the output never depends on the thread count;
+    // plain workers only touch their arena and their slice of results, so they stop allocating once warmed up
+    size_t tree_threads = threads;
+    threads = std::max<size_t>(1, std::min(shared_dag ? 1 : threads, lines.size()));
+    std::vector<std::optional<float>> results(lines.size());
+
+    // exact integer results, every literal read up to its first character that is not a digit
+    std::vector<std::optional<big_integer>> integer_results(exact_integers ? lines.size() : 0);
+
+    // with a shared DAG the whole file becomes one program, so a subexpression repeated across lines is computed once
+    expression_dag<float> dag;
+
+    // grouped by shape every worker evaluates its lines a lane group at a time
+    std::vector<size_t> shape_counts(threads);
+
+    // as native code every line is built once into the shared object cache, and later runs only load it
+    std::vector<size_t> native_counts(threads);
+
+    // a line long enough to have TREE_MIN_NODES opcodes is evaluated fork-join, on a pool of the requested number of
+    // threads shared by all workers; a character adds at most two opcodes
+    std::optional<work_stealing_pool> tree_pool;
+    size_t longest = 0;
+    for (std::string_view line : lines) {
+        longest = std::max(longest, line.size());
+    }
+    if (2 * longest >= TREE_MIN_NODES) {
+        tree_pool.emplace(tree_threads);
+    }
+
+    // with tiering every worker keeps its own hit counters and programs, and all of them share one compiler thread
+    std::optional<background_worker> compiler;
+    std::vector<std::array<std::pair<size_t, double>, tiered_engine<float>::TIERS>> tier_summaries(threads);
+    if (tier_thresholds.has_value()) {
+        compiler.emplace();
+    }
+
+    auto worker = [&](size_t index) {
+        size_t begin = lines.size() * index / threads, end = lines.size() * (index + 1) / threads;
+        scratch_arena<float> arena;
+
+        if (shared_dag) {
+            std::vector<size_t> expressions(lines.size(), SIZE_MAX);
+            for (size_t i = begin; i < end; i++) {
+                arena.input.clear();
+                for (char c : lines[i]) {
+                    if (!isspace(static_cast<unsigned char>(c))) {
+                        arena.input += c;
+                    }
+                }
+                parse<float>(std::nullopt, arena.input, arena.tokens);
+                arena.compiled.compile(arena.tokens);
+                if (arena.compiled.valid()) {
+                    expressions[i] = dag.add(arena.compiled);
+                }
+            }
+
+            dag.evaluate();
+            for (size_t i = begin; i < end; i++) {
+                if (expressions[i] != SIZE_MAX) {
+                    results[i] = dag.result(expressions[i]);
+                }
+            }
+            return;
+        }
+
+        if (grouped_shapes) {
+            shape_batch<float> batch;
+            std::vector<size_t> expressions(end - begin, SIZE_MAX);
+            for (size_t i = begin; i < end; i++) {
+                arena.input.clear();
+                for (char c : lines[i]) {
+                    if (!isspace(static_cast<unsigned char>(c))) {
+                        arena.input += c;
+                    }
+                }
+                parse<float>(std::nullopt, arena.input, arena.tokens);
+                arena.compiled.compile(arena.tokens);
+                if (arena.compiled.valid()) {
+                    expressions[i - begin] = batch.add(arena.compiled);
+                }
+            }
+
+            batch.evaluate();
+            for (size_t i = begin; i < end; i++) {
+                if (expressions[i - begin] != SIZE_MAX) {
+                    results[i] = batch.result(expressions[i - begin]);
+                }
+            }
+            shape_counts[index] = batch.shape_count();
+            return;
+        }
+
+        if (native_code) {
+            for (size_t i = begin; i < end; i++) {
+                arena.input.clear();
+                for (char c : lines[i]) {
+                    if (!isspace(static_cast<unsigned char>(c))) {
+                        arena.input += c;
+                    }
+                }
+                parse<float>(std::nullopt, arena.input, arena.tokens);
+                arena.compiled.compile(arena.tokens);
+                if (arena.compiled.valid()) {
+                    native_expression<float> built(arena.compiled);
+                    results[i] = built.evaluate();
+                    native_counts[index] += built.native();
+                }
+            }
+            return;
+        }
+
+        if (exact_integers) {
+            scratch_arena<big_integer> integer_arena;
+            for (size_t i = begin; i < end; i++) {
+                integer_results[i] = evaluate<big_integer>(lines[i], integer_arena);
+            }
+            return;
+        }
+
+        if (!tier_thresholds.has_value()) {
+            for (size_t i = begin; i < end; i++) {
+                results[i] = tree_pool.has_value() ? evaluate<float>(lines[i], arena, *tree_pool) : evaluate<float>(lines[i], arena);
+            }
+            return;
+        }
+
+        tiered_engine<float> engine(*compiler, tier_thresholds->first, tier_thresholds->second, fast_math);
+        for (size_t i = begin; i < end; i++) {
+            arena.input.clear();
+            for (char c : lines[i]) {
+                if (!isspace(static_cast<unsigned char>(c))) {
+                    arena.input += c;
+                }
+            }
+            if (!arena.input.empty()) {
+                results[i] = engine.evaluate(std::nullopt, arena.input);
+            }
+        }
+        tier_summaries[index] = engine.summary();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; i++) {
+        pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (exact_integers && integer_results[i].has_value()) {
+            std::cout << integer_results[i].value();
+        } else if (results[i].has_value()) {
+            std::cout << results[i].value();
+        } else if (!std::all_of(lines[i].begin(), lines[i].end(), [](char c) { return isspace(static_cast<unsigned char>(c)); })) {
+            std::cout << "error";
+        }
+        std::cout << "\n";
+    }
+    std::cerr << lines.size() << " expressions, " << threads << " threads, " << elapsed.count() << " s, "
+              << lines.size() / elapsed.count() << " expressions/s\n";
+    if (grouped_shapes) {
+        size_t shapes = 0;
+        for (size_t count : shape_counts) {
+            shapes += count;
+        }
+        std::cerr << shapes << " shapes, " << static_cast<double>(lines.size()) / std::max<size_t>(shapes, 1)
+                  << " lines per shape\n";
+    }
+    if (native_code) {
+        size_t native_lines = 0;
+        for (size_t count : native_counts) {
+            native_lines += count;
+        }
+        std::cerr << native_lines << " lines as native code\n";
+    }
+    if (shared_dag) {
+        std::cerr << dag.tree_node_count() << " tree nodes, " << dag.node_count() << " dag nodes, " << dag.bytes() << " bytes\n";
+    }
+    if (tier_thresholds.has_value()) {
+        for (size_t tier = 0; tier < tiered_engine<float>::TIERS; tier++) {
+            size_t expressions = 0;
+            double seconds = 0;
+            for (const auto& summary : tier_summaries) {
+                expressions += summary[tier].first;
+                seconds += summary[tier].second;
+            }
+            std::cerr << "tier " << tier << ": " << expressions << " expressions, " << seconds << " s\n";
+        }
+    }
+
+    return 0;
+}
+
+// streaming evaluation of a file too large to hold, needs mmap
+#if defined(__unix__)
+#define MAPPED_INPUT_AVAILABLE 1
+#else
+#define MAPPED_INPUT_AVAILABLE 0
+#endif
+
+// whitespace-free text collected before it is tokenized, grown only when it holds no place to cut
+const size_t STREAM_WINDOW = 1 << 20;
+
+// evaluates an expression file of any length with memory for one window of text plus the pending values and
+// operators, which grow with the depth of the parse tree: nesting, and runs of * and /, which are right-associative;
+// the file is mapped and its pages are dropped once read, and the text is tokenized in pieces that end just after a
+// '(', '*', '/' or binary '+' or '-', where the tokenizer is in the same state as at the start of an expression, so
+// the tokens are exactly those of the whole text; nullopt for a malformed expression or an unreadable file
+template <typename T>
+std::optional<T> evaluate_file(const std::string& path, size_t* depth = nullptr) {
+    reducing_evaluator<T, growing_stack> evaluator;
+    std::vector<char> window(STREAM_WINDOW);
+    size_t filled = 0;
+
+    auto consume = [&](const char* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            if (isspace(static_cast<unsigned char>(data[i]))) {
+                continue;
+            }
+            if (filled == window.size()) {
+                // a '-' is binary after a digit or ')', anywhere else it is a sign the next literal still needs
+                auto cuttable = [&](size_t cut) {
+                    char last = window[cut - 1], before = window[cut - 2];
+                    return last == '(' || last == '*' || last == '/' || (last == '+' && before != 'e' && before != 'E')
+                           || (last == '-' && (is_digit(before) || before == ')'));
+                };
+                size_t cut = filled;
+                while (cut > 1 && !cuttable(cut)) {
+                    cut--;
+                }
+                if (cut > 1) {
+                    tokenize<T>(std::nullopt, std::string_view(window.data(), cut), evaluator);
+                    std::copy(window.begin() + cut, window.begin() + filled, window.begin());
+                    filled -= cut;
+                } else {
+                    window.resize(window.size() * 2);
+                }
+            }
+            window[filled++] = data[i];
+        }
+    };
+
+#if MAPPED_INPUT_AVAILABLE
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return std::nullopt;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0) {
+        close(descriptor);
+        return std::nullopt;
+    }
+    size_t size = static_cast<size_t>(status.st_size);
+    if (size > 0) {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            close(descriptor);
+            return std::nullopt;
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        // whole pages are released behind the read position, so resident memory stays at one stride
+        const size_t STRIDE = 4 * STREAM_WINDOW;
+        const char* text = static_cast<const char*>(mapping);
+        for (size_t offset = 0; offset < size; offset += STRIDE) {
+            size_t length = std::min(STRIDE, size - offset);
+            consume(text + offset, length);
+            madvise(const_cast<char*>(text) + offset, length, MADV_DONTNEED);
+        }
+        munmap(mapping, size);
+    }
+    close(descriptor);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    std::vector<char> chunk(STREAM_WINDOW);
+    while (file.read(chunk.data(), chunk.size()) || file.gcount() > 0) {
+        consume(chunk.data(), static_cast<size_t>(file.gcount()));
+    }
+#endif
+
+    tokenize<T>(std::nullopt, std::string_view(window.data(), filled), evaluator);
+    if (depth != nullptr) {
+        *depth = evaluator.value_stack().peak() + evaluator.operator_stack().peak();
+    }
+    return evaluator.finish();
+}
+
+// peak resident set size of the process in bytes, 0 where it is not available
+size_t peak_resident_bytes() {
+#if defined(__unix__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    }
+#endif
+    return 0;
+}
+
+// stream mode, evaluates one expression file and reports throughput and memory on stderr
+int run_stream(const std::string& path) {
+    std::error_code error;
+    uintmax_t bytes = std::filesystem::file_size(path, error);
+    if (error) {
+        std::cerr << "cannot open " << path << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t depth = 0;
+    std::optional<double> result = evaluate_file<double>(path, &depth);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (result.has_value()) {
+        std::cout << result.value() << "\n";
+    } else {
+        std::cout << "error\n";
+    }
+    std::cerr << bytes << " bytes, " << elapsed.count() << " s, " << bytes / elapsed.count() / 1e6 << " MB/s, stack depth "
+              << depth << ", peak resident " << peak_resident_bytes() / 1024 << " KiB\n";
+    return result.has_value() ? 0 : 1;
+}
+
+// parallel mode, evaluates one expression file on threads threads and reports throughput on stderr
+int run_parallel(const std::string& path, size_t threads) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "cannot open " << path << "\n";
+        return 1;
+    }
+    std::string expression((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t bytes = expression.size();
+    expression.erase(std::remove_if(expression.begin(), expression.end(), isspace), expression.end());
+
+    auto start = std::chrono::steady_clock::now();
+    std::optional<double> result = evaluate_parallel<double>(expression, threads);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (result.has_value()) {
+        std::cout << result.value() << "\n";
+    } else {
+        std::cout << "error\n";
+    }
+    std::cerr << bytes << " bytes, " << threads << " threads, " << elapsed.count() << " s, "
+              << expression.size() / elapsed.count() / 1e6 << " MB/s\n";
+    return result.has_value() ? 0 : 1;
+}
+
+// check mode, asserts what the benchmarks only report; one function per component, each failed check is printed
+// with the component it belongs to
+class checker {
+public:
+
+    void component(const std::string& name) {
+        current = name;
+    }
+
+    void operator()(bool passed, const std::string& description) {
+        total++;
+        if (!passed) {
+            std::cout << "  failed: " << current << ": " << description << "\n";
+            failed++;
+        }
+    }
+
+    size_t checks() const {
+        return total;
+    }
+
+    size_t failures() const {
+        return failed;
+    }
+
+private:
+
+    std::string current;
+    size_t total = 0;
+    size_t failed = 0;
+};
+
+// equal values with equal signs, or both NaN; the backends run the same operations in the same order as the stack
+// interpreter, so this is what they must agree on
+template <typename T>
+bool same_result(T lhs, T rhs) {
+    return (lhs == rhs && std::signbit(lhs) == std::signbit(rhs)) || (std::isnan(lhs) && std::isnan(rhs));
+}
+
+// variables of the generated formulas the checks run
+const std::vector<std::string> CHECK_NAMES = {"x", "y", "z"};
+const float CHECK_FLOAT_VALUES[] = {1.25f, -2.5f, 3.75f};
+const double CHECK_DOUBLE_VALUES[] = {1.25, -2.5, 3.75};
+
+// out of range literals round like any other: past the largest finite value to infinity, below the smallest
+// subnormal to zero, on every path that converts them; the conversions a constant expression uses round like the
+// run time one, including halfway and subnormal cases
+void check_literals(checker& check) {
+    auto literal_converts = [&]<typename T>(const std::string& literal, T expected) {
+        scratch_arena<T> arena;
+        std::optional<T> line = evaluate_line<T>(std::nullopt, literal), arena_result = evaluate<T>(literal, arena);
+        T value = parse_number<T>(literal);
+        check(value == expected && std::signbit(value) == std::signbit(expected), literal + " as a literal");
+        check(line.has_value() && line.value() == expected, literal + " as a line");
+        check(arena_result.has_value() && arena_result.value() == expected, literal + " in an arena");
+    };
+    const float FLOAT_INFINITY = std::numeric_limits<float>::infinity();
+    const double DOUBLE_INFINITY = std::numeric_limits<double>::infinity();
+    literal_converts("1e39", FLOAT_INFINITY);
+    literal_converts("-1e39", -FLOAT_INFINITY);
+    literal_converts("340282366920938463463374607431768211456000", FLOAT_INFINITY);
+    literal_converts("3.4028236e38", FLOAT_INFINITY);
+    literal_converts("3.4028235e38", std::numeric_limits<float>::max());
+    literal_converts("1e-46", 0.0f);
+    literal_converts("-1e-50", -0.0f);
+    literal_converts("1e309", DOUBLE_INFINITY);
+    literal_converts("-1e400", -DOUBLE_INFINITY);
+    literal_converts("0.1e-400", 0.0);
+
+    auto constant_conversion_agrees = [&]<typename T>(const std::string& literal, T) {
+        using bits = typename binary_format<T>::bits;
+        T runtime = parse_number<T>(literal), fast = 0;
+        T exact = parse_decimal_exact<T>(literal);
+        bool fast_agrees = true;
+#if FAST_FLOAT_AVAILABLE
+        fast_agrees = !parse_float_fast(literal, fast) || std::bit_cast<bits>(fast) == std::bit_cast<bits>(runtime);
+#endif
+        check(std::bit_cast<bits>(exact) == std::bit_cast<bits>(runtime) && fast_agrees, literal + " converted during compilation");
+    };
+    std::vector<std::string> hard_literals = {"90639042881.275946e26", "9007199254740993", "2.4703282292062327e-324",
+                                              "2.4703282292062328e-324", "4.9406564584124654e-324", "2.2250738585072011e-308",
+                                              "1.7976931348623158e308", "1.7976931348623159e308", "7.038531e-26", "1.1754942e-38",
+                                              "1.4012984643e-45", "7.0064923216e-46", "3.4028235677973366e38",
+                                              "0.000000000000000000000000000000000000000000000000000000000000000001e50",
+                                              "123456789012345678901234567890.123456789e-10", "0", "-0.0e5", "12.e", "-3e-"};
+    std::mt19937 random(20);
+    std::uniform_int_distribution<int> digit(0, 9), length(1, 24), exponent(-360, 320);
+    for (int i = 0; i < 2000; i++) {
+        std::string literal;
+        for (int digits = length(random), k = 0; k < digits; k++) {
+            literal += static_cast<char>('0' + digit(random));
+            literal += k == 0 && i % 3 == 0 ? "." : "";
+        }
+        hard_literals.push_back(literal + "e" + std::to_string(i % 2 ? exponent(random) : exponent(random) / 8));
+    }
+    for (const auto& literal : hard_literals) {
+        constant_conversion_agrees(literal, 0.0);
+        constant_conversion_agrees(literal, 0.0f);
+    }
+}
+
+// a formula folded during compilation has the value the same text has when it is parsed at run time
+void check_constant_expressions(checker& check) {
+    constexpr double folded = compile_fixed<double, "90639042881.275946e26*3-2.2250738585072011e-308/7">();
+    std::optional<double> parsed = evaluate_line<double>(std::nullopt, "90639042881.275946e26*3-2.2250738585072011e-308/7");
+    check(parsed.has_value() && std::bit_cast<uint64_t>(parsed.value()) == std::bit_cast<uint64_t>(folded), "formula folded during compilation");
+
+    constexpr auto fixed = compile_fixed<float, "x*7.038531e-26+1.1754942e-38">();
+    variable_table names;
+    compiled_expression<float> runtime(parse<float>(std::nullopt, "x*7.038531e-26+1.1754942e-38", &names));
+    const float x = 3.0f;
+    check(std::bit_cast<uint32_t>(fixed(x)) == std::bit_cast<uint32_t>(runtime.evaluate(&x)), "formula compiled during compilation");
+}
+
+// a literal that ends in the sign of an empty exponent cannot take a parenthesis, a lone unary minus can
+void check_tokenizer(checker& check) {
+    auto line_evaluates = [&](const std::string& expression, std::optional<double> expected) {
+        scratch_arena<double> arena;
+        check(evaluate_line<double>(std::nullopt, expression) == expected, expression + " as a line");
+        check(evaluate<double>(expression, arena) == expected, expression + " in an arena");
+    };
+    line_evaluates("3*2e-(1)", std::nullopt);
+    line_evaluates("3*2e+(1)", std::nullopt);
+    line_evaluates("3*-(1)", -3.0);
+    line_evaluates("3*2e-1", 0.6000000000000001);
+}
+
+// the SIMD structural masks mark the bytes the bytewise classifier marks, and an indexed scan emits the tokens of a
+// bytewise one, bit for bit and with the same variable table, wherever literals and operators fall in a 64-byte block
+void check_structural_index(checker& check) {
+    std::mt19937 random(19);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<char> data(5 * STRUCTURAL_BLOCK);
+    for (int round = 0; round < 200; round++) {
+        for (char& c : data) {
+            c = static_cast<char>(round % 2 == 0 ? byte(random) : "+-*/().,0e"[byte(random) % 10]);
+        }
+        uint64_t expected[5], masks[5];
+        structural_masks_bytewise(data.data(), 5, expected);
+#if defined(__x86_64__)
+        structural_masks_sse2(data.data(), 5, masks);
+        check(std::equal(masks, masks + 5, expected), "SSE2 masks of round " + std::to_string(round));
+        if (__builtin_cpu_supports("avx2")) {
+            structural_masks_avx2(data.data(), 5, masks);
+            check(std::equal(masks, masks + 5, expected), "AVX2 masks of round " + std::to_string(round));
+        }
+#else
+        structural_masks()(data.data(), 5, masks);
+        check(std::equal(masks, masks + 5, expected), "masks of round " + std::to_string(round));
+#endif
+    }
+
+    auto same_tokens = [](const token<double>& lhs, const token<double>& rhs) {
+        if (lhs.index() != rhs.index()) {
+            return false;
+        }
+        if (const double* value = std::get_if<double>(&lhs)) {
+            return std::bit_cast<uint64_t>(*value) == std::bit_cast<uint64_t>(std::get<double>(rhs));
+        }
+        if (const variable* name = std::get_if<variable>(&lhs)) {
+            return name->index == std::get<variable>(rhs).index;
+        }
+        return std::get<special_char>(lhs).value == std::get<special_char>(rhs).value;
+    };
+    auto scans_agree = [&](const std::string& expression, bool named, const std::string& description) {
+        std::vector<token<double>> bytewise, indexed;
+        variable_table bytewise_names, indexed_names;
+        const std::optional<token<double>> previous = 2.5;
+        tokenize<double>(previous, expression, [&](const token<double>& t) { bytewise.push_back(t); },
+                         named ? &bytewise_names : nullptr, scan_mode::bytewise);
+        tokenize<double>(previous, expression, [&](const token<double>& t) { indexed.push_back(t); },
+                         named ? &indexed_names : nullptr, scan_mode::indexed);
+        check(std::equal(bytewise.begin(), bytewise.end(), indexed.begin(), indexed.end(), same_tokens)
+              && bytewise_names == indexed_names, description + (named ? " with variables" : " without variables"));
+    };
+
+    // every piece starts at every offset of a block, so each of its characters meets a block boundary
+    for (const std::string piece : {"12345678901234567890.5e-3", "2e+(1)", "3*-(x)", ")(y1-2)(", "-x*-1.5e+7/-(z)",
+                                    "2(3+4)(5-6)", "1e", "-"}) {
+        for (size_t offset = 0; offset < STRUCTURAL_BLOCK; offset++) {
+            std::string expression = std::string(offset, '7') + "+" + piece + "+" + std::string(STRUCTURAL_BLOCK - offset, '8');
+            for (bool named : {false, true}) {
+                scans_agree(expression, named, piece + " at " + std::to_string(offset));
+            }
+        }
+    }
+    for (int i = 0; i < 20; i++) {
+        std::string expression = random_expression(random, CHECK_NAMES, 12);
+        for (bool named : {false, true}) {
+            scans_agree(expression, named, expression.substr(0, 40));
+        }
+    }
+}
+
+// a program missing an operand or a parenthesis is malformed however it is evaluated, and evaluates to T() rather
+// than reading past its stack
+void check_compiled_expression(checker& check) {
+    for (const std::string expression : {"1+2)", ")", "(1+2))*3", "(1+2", "1+", "*2", "()"}) {
+        std::vector<token<double>> tokens = parse<double>(std::nullopt, expression);
+        compiled_expression<double> compiled(tokens);
+        check(!compiled.valid() && compiled.evaluate() == 0.0, expression + " compiled");
+        check(!evaluate<double>(tokens).has_value(), expression + " evaluated");
+        check(!evaluate_line<double>(std::nullopt, expression).has_value(), expression + " as a line");
+    }
+    check(evaluate<double>(parse<double>(std::nullopt, "(1+2)*3")) == 9.0, "(1+2)*3 evaluated");
+}
+
+// the optimizer keeps every bit of the result, -0, infinities and NaN included, and only fast math reassociates
+void check_optimizer(checker& check) {
+    const double special[] = {0.0, -0.0, 1.5, -2.5, 1e308, -1e308, std::numeric_limits<double>::infinity(),
+                              -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN(),
+                              std::numeric_limits<double>::denorm_min()};
+    auto same_bits = [](double lhs, double rhs) {
+        return std::bit_cast<uint64_t>(lhs) == std::bit_cast<uint64_t>(rhs);
+    };
+    auto keeps_bits = [&](const std::string& expression, const std::vector<std::string>& names, bool fast_math) {
+        variable_table table = names;
+        compiled_expression<double> original(parse<double>(std::nullopt, expression, &table));
+        compiled_expression<double> optimized = optimize(original, fast_math);
+        bool same = true;
+        for (double x : special) {
+            for (double y : special) {
+                const double values[] = {x, y, 3.75};
+                same = same && same_bits(optimized.evaluate(values), original.evaluate(values));
+            }
+        }
+        return same;
+    };
+
+    const std::vector<std::string> names = {"x", "y"};
+    for (const std::string expression : {"x+0", "0+x", "x+-0", "-0+x", "x-0", "x--0", "0-x", "x*1", "1*x", "x*0",
+                                         "0*x", "x*-0", "x/1", "x/-1", "0/x", "-(-x)", "-(-(x))", "--x", "-x*-y",
+                                         "-(x)*-(y)", "-(x*-y)", "-(x/-y)", "-x/-y", "x+-y", "x--y", "-1*x", "x*-1",
+                                         "0*1e308*10+x", "1e308*10*x", "1e308*10-1e308*10+x", "0/0*x", "x*(1e308+1e308)",
+                                         "1e308+1e308-1e308+x", "-0*-0+x", "(0-0)*-1+x", "1e-320/1e10*x", "x+1e308+1e308"}) {
+        check(keeps_bits(expression, names, false), expression + " optimized");
+    }
+    std::mt19937 random(16);
+    for (int i = 0; i < 50; i++) {
+        std::string expression = random_expression(random, names, 5);
+        check(keeps_bits(expression, names, false), expression.substr(0, 60) + " optimized");
+    }
+
+    // 1+1e16 rounds back to 1e16 and 10*1e308 overflows, so only a reassociated sum or product keeps the 1 or the 10
+    for (const std::string expression : {"x+1e16-1e16", "1e16+x-1e16+y", "1e-308*x*1e308"}) {
+        check(keeps_bits(expression, names, false), expression + " optimized");
+        variable_table table = names;
+        compiled_expression<double> original(parse<double>(std::nullopt, expression, &table));
+        const double values[] = {expression.ends_with("1e308") ? 10.0 : 1.0, 1.0};
+        check(!same_bits(optimize(original, true).evaluate(values), original.evaluate(values)),
+              expression + " reassociated with fast math");
+    }
+}
+
+// a shared dag gives every expression the bits of its own program, stores a repeated subexpression once, and keeps
+// constants that compare equal but differ in their bits, 0 and -0, apart
+void check_dag(checker& check) {
+    std::mt19937 random(18);
+    std::vector<std::string> library;
+    for (int i = 0; i < 8; i++) {
+        library.push_back(random_expression(random, CHECK_NAMES, 3));
+    }
+    std::vector<std::string> expressions = {"x*0", "x*-0", "(x*0+y)/z", "(x*-0+y)/z", "x*0"};
+    const char operators[] = "+-*/";
+    for (int i = 0; i < 200; i++) {
+        expressions.push_back(library[random() % library.size()] + operators[random() % 4] + library[random() % library.size()]);
+    }
+
+    std::vector<compiled_expression<double>> programs;
+    expression_dag<double> dag;
+    for (const std::string& expression : expressions) {
+        variable_table names = CHECK_NAMES;
+        programs.emplace_back(parse<double>(std::nullopt, expression, &names));
+        dag.add(programs.back());
+    }
+    size_t nodes = dag.node_count();
+    dag.add(programs[0]);
+    check(dag.node_count() == nodes && dag.node_count() < dag.tree_node_count() / 4, "repeated subexpressions stored once");
+
+    dag.evaluate(CHECK_DOUBLE_VALUES);
+    for (size_t i = 0; i < programs.size(); i++) {
+        check(std::bit_cast<uint64_t>(dag.result(i)) == std::bit_cast<uint64_t>(programs[i].evaluate(CHECK_DOUBLE_VALUES)),
+              expressions[i].substr(0, 60) + " in a dag");
+    }
+}
+
+// column evaluation refuses a malformed program and one with more variables than columns
+void check_columns(checker& check) {
+    std::vector<double> values(4, 1.0), out(4, 0.0);
+    variable_table names;
+    compiled_expression<double> two_columns(parse<double>(std::nullopt, "x+y", &names));
+    check(!evaluate_columns(two_columns, {values.data()}, values.size(), out.data()), "too few columns");
+    compiled_expression<double> malformed(parse<double>(std::nullopt, "x+", &names));
+    check(!evaluate_columns(malformed, {values.data(), values.data()}, values.size(), out.data()), "malformed column program");
+    check(evaluate_columns(two_columns, {values.data(), values.data()}, values.size(), out.data()) && out[3] == 2.0,
+          "column evaluation");
+}
+
+// every expression of a shape batch has the bits of its own program, in full lane groups, in a last group that is
+// only partly filled, and in shapes that share their constants or have none
+void check_shapes(checker& check) {
+    std::mt19937 random(24);
+    std::uniform_int_distribution<int> digit(1, 9);
+    std::vector<std::string> templates = {"x+y", "-x*0", "1.5*x-2.5"};
+    for (int i = 0; i < 5; i++) {
+        templates.push_back(random_expression(random, CHECK_NAMES, 4));
+    }
+
+    for (size_t members : {size_t(1), SHAPE_LANES - 1, SHAPE_LANES, SHAPE_LANES + 1, 3 * SHAPE_LANES + 5}) {
+        std::vector<std::string> expressions;
+        std::vector<compiled_expression<double>> programs;
+        shape_batch<double> batch;
+        for (size_t i = 0; i < members * templates.size(); i++) {
+            std::string expression = templates[i % templates.size()];
+            // every fourth member repeats its template unchanged, the others get fresh digits
+            for (char& c : expression) {
+                c = is_digit(c) && i % 4 != 0 ? static_cast<char>('0' + digit(random)) : c;
+            }
+            variable_table names = CHECK_NAMES;
+            expressions.push_back(expression);
+            programs.emplace_back(parse<double>(std::nullopt, expression, &names));
+            batch.add(programs.back());
+        }
+        check(batch.shape_count() == templates.size(), std::to_string(members) + " members per shape");
+
+        batch.evaluate(CHECK_DOUBLE_VALUES);
+        for (size_t i = 0; i < programs.size(); i++) {
+            check(std::bit_cast<uint64_t>(batch.result(i)) == std::bit_cast<uint64_t>(programs[i].evaluate(CHECK_DOUBLE_VALUES)),
+                  expressions[i].substr(0, 60) + " as member " + std::to_string(i / templates.size()) + " of "
+                  + std::to_string(members));
+        }
+    }
+}
+
+// once their buffers have grown, one-pass and arena evaluation never touch the heap, nor does a REPL line the result
+// cache answers; the result cache and tiered engine still allocate when they miss, as does parse + evaluate
+void check_allocations(checker& check) {
+    auto allocation_free = [&](auto&& function, const std::string& description) {
+        function();
+        size_t before = allocation_count;
+        for (int i = 0; i < 100; i++) {
+            function();
+        }
+        // counted before the description is built, which allocates
+        bool passed = allocation_count == before;
+        check(passed, description + " without allocations");
+    };
+    scratch_arena<float> arena;
+    allocation_free([&]() {
+        for (const auto& expression : BENCH_EXPRESSIONS) {
+            evaluate_line<float>(std::nullopt, expression);
+        }
+    }, "one-pass evaluation");
+    allocation_free([&]() {
+        for (const auto& expression : BENCH_EXPRESSIONS) {
+            evaluate<float>(expression, arena);
+        }
+    }, "arena evaluation");
+
+    // a REPL line the result cache answers costs its key, the cache lookup and the tiered engine's hit count, none
+    // of which allocate once every line has reached the last tier
+    background_worker compiler;
+    tiered_engine<float> engine(compiler, 1, 2);
+    result_cache<float> cache(1 << 20);
+    std::string key;
+    const std::optional<token<float>> previous = token<float>(2.5f);
+    std::vector<std::string> inputs = BENCH_EXPRESSIONS;
+    inputs.push_back("*3+1");
+    auto answer = [&]() {
+        for (const auto& input : inputs) {
+            make_cache_key(key, input, previous);
+            if (const std::optional<float>* cached = cache.find(key)) {
+                engine.record_hit(previous, input, !cached->has_value());
+            } else {
+                cache.insert(key, engine.evaluate(previous, input));
+            }
+        }
+    };
+    for (int i = 0; i < 1000 && engine.summary()[2].first < inputs.size(); i++) {
+        answer();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    allocation_free(answer, "REPL line answered by the result cache");
+}
+
+// the JIT agrees with the stack interpreter to the bit, on a formula deep enough to spill past xmm13 too
+void check_jit(checker& check) {
+    auto jit_agrees = [&]<typename T>(const std::string& expression, const std::vector<std::string>& names, const T* values) {
+        variable_table table = names;
+        compiled_expression<T> compiled(parse<T>(std::nullopt, expression, &table));
+        jit_expression<T> jit(compiled);
+        check(!JIT_AVAILABLE || jit.native(), expression.substr(0, 60) + " compiled to native code");
+        check(same_result(jit.evaluate(values), compiled.evaluate(values)), expression.substr(0, 60) + " in the JIT");
+    };
+    for (const auto& expression : BENCH_EXPRESSIONS) {
+        jit_agrees(expression, {}, CHECK_FLOAT_VALUES);
+        jit_agrees(expression, {}, CHECK_DOUBLE_VALUES);
+    }
+    std::mt19937 random(7);
+    for (int i = 0; i < 20; i++) {
+        std::string expression = random_expression(random, CHECK_NAMES, 6);
+        jit_agrees(expression, CHECK_NAMES, CHECK_FLOAT_VALUES);
+        jit_agrees(expression, CHECK_NAMES, CHECK_DOUBLE_VALUES);
+    }
+
+    // right-nested, so the stack is 40 deep and everything past xmm13 goes through the spill slots
+    std::string deep;
+    const char operators[] = "-*+/";
+    for (int i = 0; i < 40; i++) {
+        deep += CHECK_NAMES[i % 3] + operators[i % 4] + "(" + std::to_string(i + 1) + ".5" + operators[(i + 1) % 4];
+    }
+    deep += "z" + std::string(40, ')');
+    jit_agrees(deep, CHECK_NAMES, CHECK_FLOAT_VALUES);
+    jit_agrees(deep, CHECK_NAMES, CHECK_DOUBLE_VALUES);
+}
+
+// without fast math the register machine rounds every product before it is added, superinstructions included
+void check_register_machine(checker& check) {
+    std::mt19937 random(11);
+    for (int i = 0; i < 200; i++) {
+        variable_table table = CHECK_NAMES;
+        compiled_expression<double> compiled(parse<double>(std::nullopt, random_expression(random, CHECK_NAMES, 6), &table));
+        register_expression<double> registers(compiled);
+        check(same_result(registers.evaluate(CHECK_DOUBLE_VALUES), compiled.evaluate(CHECK_DOUBLE_VALUES)),
+              "register machine on a generated formula");
+    }
+}
+
+// both dispatch loops agree with the stack interpreter to the bit, and neither runs a malformed program
+void check_dispatch(checker& check) {
+    auto dispatch_agrees = [&](const std::string& expression, const std::vector<std::string>& names) {
+        variable_table table = names;
+        compiled_expression<double> compiled(parse<double>(std::nullopt, expression, &table));
+        threaded_expression<double, true> threaded(compiled);
+        threaded_expression<double, false> switched(compiled);
+        double expected = compiled.valid() ? compiled.evaluate(CHECK_DOUBLE_VALUES) : 0.0;
+        check(same_result(threaded.evaluate(CHECK_DOUBLE_VALUES), expected), expression.substr(0, 60) + " threaded");
+        check(same_result(switched.evaluate(CHECK_DOUBLE_VALUES), expected), expression.substr(0, 60) + " with a switch");
+    };
+    for (const auto& expression : BENCH_EXPRESSIONS) {
+        dispatch_agrees(expression, {});
+    }
+    std::mt19937 random(12);
+    for (int i = 0; i < 50; i++) {
+        dispatch_agrees(random_expression(random, CHECK_NAMES, 6), CHECK_NAMES);
+    }
+    for (const std::string expression : {"1+", "*", "(1+2", "1+2)"}) {
+        dispatch_agrees(expression, {});
+    }
+}
+
+// where a system compiler builds one formula it builds any, infinite and NaN constants included
+void check_native(checker& check) {
+    std::string directory = (std::filesystem::temp_directory_path()
+                             / ("calculator-check-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()))).string();
+    native_expression<double> finite(compiled_expression<double>(parse<double>(std::nullopt, "1+2")), directory);
+    if (finite.native()) {
+        native_expression<double> infinite(compiled_expression<double>(parse<double>(std::nullopt, "2*1e400")), directory);
+        check(infinite.native() && infinite.evaluate() == std::numeric_limits<double>::infinity(), "infinite constant in native code");
+
+        // integer constants are cast too, since a functional cast to a two-word type such as long long does not parse
+        variable_table names = CHECK_NAMES;
+        compiled_expression<long long> integers(parse<long long>(std::nullopt, "(7/2*x+300000000000)-y*z", &names));
+        native_expression<long long> integer(integers, directory);
+        const long long values[] = {5, -3, 11};
+        check(integer.native() && integer.evaluate(values) == integers.evaluate(values), "long long program in native code");
+        compiled_expression<int> small_integers(parse<int>(std::nullopt, "7/2*x-y*z", &names));
+        native_expression<int> small_integer(small_integers, directory);
+        const int small_values[] = {5, -3, 11};
+        check(small_integer.native() && small_integer.evaluate(small_values) == small_integers.evaluate(small_values),
+              "int program in native code");
+
+        native_expression<double> cached(compiled_expression<double>(parse<double>(std::nullopt, "1+2")), directory);
+        check(cached.native() && !cached.built() && cached.evaluate() == 3, "object loaded from the cache in native code");
+
+        // an object whose stored source is another formula is never loaded, as if two sources had the same hash
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            if (entry.path().extension() == ".cpp") {
+                std::ofstream(entry.path()) << "extern \"C\" double calculator_evaluate(const double*) { return 4; }\n";
+            }
+        }
+        native_expression<double> collided(compiled_expression<double>(parse<double>(std::nullopt, "1+2")), directory);
+        check(!collided.native() && collided.evaluate() == 3, "object under a colliding name in native code");
+    }
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+}
+
+// with fast math a line has the same value before and after it is promoted
+void check_tiers(checker& check) {
+    background_worker compiler;
+    tiered_engine<float> engine(compiler, 2, 4, true);
+    const std::string line = "+0.2+0.3+0.7+1e8-1e8+0.1";
+    const std::optional<token<float>> carried = token<float>(0.1f);
+    std::optional<float> first = engine.evaluate(carried, line);
+    bool unchanged = first.has_value();
+    for (int i = 0; i < 1000 && engine.summary()[2].first == 0; i++) {
+        unchanged = unchanged && engine.evaluate(carried, line) == first;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    unchanged = unchanged && engine.evaluate(carried, line) == first;
+    check(unchanged && engine.summary()[2].first == 1, "fast math value across tiers");
+}
+
+// fork-join evaluation of a tree has the bits of the stack walk, with small cutoffs so that it forks a lot
+void check_fork_join(checker& check) {
+    std::mt19937 random(23);
+    variable_table names = CHECK_NAMES;
+    compiled_expression<double> program(parse<double>(std::nullopt, random_expression(random, CHECK_NAMES, 14), &names));
+    scratch_arena<float> arena, tree_arena;
+    for (size_t threads : {size_t(1), size_t(2), size_t(4)}) {
+        work_stealing_pool pool(threads);
+        for (size_t cutoff : {size_t(2), size_t(64), TREE_TASK_CUTOFF}) {
+            expression_tree<double> tree(program, cutoff);
+            check(same_result(tree.evaluate(pool, CHECK_DOUBLE_VALUES), program.evaluate(CHECK_DOUBLE_VALUES)),
+                  "fork-join on " + std::to_string(threads) + " threads, cutoff " + std::to_string(cutoff));
+        }
+        for (const std::string& expression : {BENCH_EXPRESSIONS[1], BENCH_EXPRESSIONS[5], std::string("(1+2")}) {
+            check(evaluate<float>(expression, tree_arena, pool, 1) == evaluate<float>(expression, arena), expression + " fork-join");
+        }
+    }
+}
+
+// streaming a file gives the bits of evaluating its whole text, wherever a window boundary falls: inside a literal,
+// inside a parenthesis group, in a literal longer than a window, or in a last window that is only partly filled
+void check_stream(checker& check) {
+    std::string path = (std::filesystem::temp_directory_path()
+                        / ("calculator-check-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+                           + ".txt")).string();
+    auto stream_agrees = [&](const std::string& text, const std::string& description) {
+        std::ofstream(path, std::ios::binary) << text;
+        std::string whole = text;
+        whole.erase(std::remove_if(whole.begin(), whole.end(), isspace), whole.end());
+        std::optional<double> streamed = evaluate_file<double>(path);
+        std::optional<double> expected = evaluate_line<double>(std::nullopt, whole);
+        check(streamed.has_value() == expected.has_value() && (!expected || same_result(*streamed, *expected)), description);
+    };
+
+    // a sum of exactly size bytes, ending in a binary '+'
+    auto terms = [](size_t size) {
+        size_t digits = (size - 2) % 4;
+        std::string text = "1" + std::string(digits, '0') + "+";
+        while (text.size() < size) {
+            text += "0.5+";
+        }
+        return text;
+    };
+
+    for (const std::string piece : {"12345.6789e+12", "-12345.6789e-12", "(2.5*(3-4.75)/(1.5+0.5))", "-(7/(2-(0.5*3)))"}) {
+        for (size_t offset = 1; offset < piece.size(); offset++) {
+            stream_agrees(terms(STREAM_WINDOW - offset) + piece + "*3-1", piece + " cut after " + std::to_string(offset) + " bytes");
+        }
+    }
+    stream_agrees("1." + std::string(STREAM_WINDOW + STREAM_WINDOW / 2, '0') + "1+2", "literal longer than a window");
+    stream_agrees("(" + terms(2 * STREAM_WINDOW + 12345) + "1)*2", "parenthesis group over three windows");
+    stream_agrees(terms(STREAM_WINDOW - 1) + "1", "exactly one window");
+    stream_agrees(terms(STREAM_WINDOW) + "1", "one byte past a window");
+    stream_agrees(terms(100) + "1", "less than a window");
+
+    std::string lines = terms(STREAM_WINDOW + 5000) + "1";
+    for (size_t i = 80; i < lines.size(); i += 80) {
+        lines.insert(i, "\n ");
+    }
+    stream_agrees(lines, "text broken into lines");
+    stream_agrees(terms(STREAM_WINDOW + 10) + "(1", "unmatched parenthesis");
+    std::error_code error;
+    std::filesystem::remove(path, error);
+}
+
+// an expression split across threads has the same bits on one thread as on several, and where every partial sum is
+// exact, the bits of one-pass evaluation; the texts span several chunks so that they are cut
+void check_parallel(checker& check) {
+    auto repeat = [](const std::string& term, size_t size) {
+        std::string text;
+        while (text.size() < size) {
+            text += term;
+        }
+        return text;
+    };
+    const size_t size = 3 * PARALLEL_CHUNK + 12345;
+    const std::string nested = std::string(100000, '(') + repeat("0.5+0.25*2-", size) + "1" + std::string(100000, ')');
+    const std::pair<std::string, bool> texts[] = {
+        {repeat("0.5+1.25*2-0.75/4+", size) + "1", true},
+        {"-" + repeat("0.5--0.25+", size) + "1", true},
+        {"-(" + repeat("0.5-0.25*-2+", size) + "1)+" + repeat("-1.5+", size) + "2", true},
+        {nested, true},
+        {nested + "+" + nested + "*-2", true},
+        {"2*(" + repeat("0.5+", size) + "1)", true},
+        {repeat("(0.1+0.2)*3-2.5e-3+1e+2/7+", size) + "1", false},
+        {repeat("0.1+", size) + "(1", false}};
+
+    for (const auto& [text, exact] : texts) {
+        std::string description = text.substr(0, 20) + ", " + std::to_string(text.size()) + " bytes";
+        std::optional<double> single = evaluate_parallel<double>(text, 1);
+        for (size_t threads : {size_t(2), size_t(4), size_t(7)}) {
+            std::optional<double> split = evaluate_parallel<double>(text, threads);
+            check(split.has_value() == single.has_value() && (!single || same_result(*split, *single)),
+                  description + " on " + std::to_string(threads) + " threads");
+        }
+        std::optional<double> expected = evaluate_line<double>(std::nullopt, text);
+        check(single.has_value() == expected.has_value() && (!exact || !expected || same_result(*single, *expected)),
+              description + " against one pass");
+    }
+}
+
+// every multiplication algorithm agrees with schoolbook on operands just below, at and just above the length where
+// it takes over, and division undoes the product, through a Newton reciprocal once both are long
+void check_big_integer(checker& check) {
+    std::mt19937 random(25);
+    std::uniform_int_distribution<uint32_t> random_limb;
+    auto random_integer = [&](size_t limb_count, bool signed_value = true) {
+        big_integer value(0);
+        for (size_t i = 0; i < limb_count; i++) {
+            value = value * big_integer(1ll << 32) + big_integer(static_cast<long long>(random_limb(random) | (i == 0)));
+        }
+        return signed_value && random_limb(random) % 2 ? -value : value;
+    };
+    const std::vector<std::pair<size_t, size_t>> operand_limbs = {
+        {KARATSUBA_THRESHOLD - 1, KARATSUBA_THRESHOLD - 1}, {KARATSUBA_THRESHOLD, KARATSUBA_THRESHOLD},
+        {KARATSUBA_THRESHOLD + 1, 3 * KARATSUBA_THRESHOLD}, {TOOM3_THRESHOLD - 1, TOOM3_THRESHOLD},
+        {TOOM3_THRESHOLD + 1, TOOM3_THRESHOLD + 1}, {TOOM3_THRESHOLD + 1, 5 * TOOM3_THRESHOLD}, {NTT_THRESHOLD - 1, NTT_THRESHOLD},
+        {NTT_THRESHOLD + 1, NTT_THRESHOLD + 1}, {NTT_THRESHOLD + 1, 2 * NTT_THRESHOLD}};
+    for (auto [lhs_limbs, rhs_limbs] : operand_limbs) {
+        big_integer a = random_integer(lhs_limbs), b = random_integer(rhs_limbs);
+        big_integer expected = big_integer::multiply(a, b, multiplication::schoolbook);
+        std::string sizes = std::to_string(lhs_limbs) + " by " + std::to_string(rhs_limbs) + " limbs";
+        for (auto [method, name] : {std::pair(multiplication::karatsuba, "karatsuba"), std::pair(multiplication::toom3, "toom-3"),
+                                    std::pair(multiplication::ntt, "ntt"), std::pair(multiplication::automatic, "automatic")}) {
+            check(big_integer::multiply(a, b, method) == expected, std::string(name) + " product of " + sizes);
+        }
+        check(expected / b == a, "quotient of a product of " + sizes);
+    }
+    for (size_t limbs : {NEWTON_THRESHOLD - 1, NEWTON_THRESHOLD, NEWTON_THRESHOLD + 1}) {
+        big_integer quotient = random_integer(limbs, false), divisor = random_integer(limbs, false);
+        big_integer dividend = quotient * divisor + divisor - big_integer(1);
+        check(dividend / divisor == quotient, "quotient with the largest remainder, " + std::to_string(limbs) + " limbs");
+        check(big_integer::from_string(dividend.to_string()) == dividend, "decimal round trip, " + std::to_string(limbs) + " limbs");
+    }
+}
+
+// a line that starts a new expression has the same cache key whatever result it follows, one that continues the
+// result does not
+void check_result_cache(checker& check) {
+    std::string key, carried_key;
+    make_cache_key<float>(key, "2+3", std::nullopt);
+    make_cache_key<float>(carried_key, "2+3", token<float>(5.0f));
+    check(key == carried_key, "new expression cache key");
+    make_cache_key<float>(key, "*3", token<float>(2.0f));
+    make_cache_key<float>(carried_key, "*3", token<float>(5.0f));
+    check(key != carried_key, "continued expression cache key");
+
+    // room for three entries: a fourth evicts whichever was used least recently, lookups included
+    auto stats = [](const result_cache<float>& cache) {
+        std::ostringstream out;
+        out << cache;
+        return out.str();
+    };
+    size_t bytes = result_cache<float>::entry_bytes("k0");
+    result_cache<float> cache(3 * bytes);
+    for (const char* name : {"k0", "k1", "k2"}) {
+        cache.insert(name, name[1] - '0');
+    }
+    const std::optional<float>* first = cache.find("k0");
+    check(first != nullptr && *first == 0.0f, "cached result");
+    cache.insert("k3", 3.0f);
+    check(cache.find("k1") == nullptr, "least recently used entry evicted");
+    check(cache.find("k2") != nullptr && cache.find("k3") != nullptr && cache.find("k0") != nullptr, "recent entries kept");
+    cache.insert("k4", 4.0f);
+    check(cache.find("k2") == nullptr && cache.find("k0") != nullptr, "entry evicted after the lookups");
+    cache.insert("k0", 5.0f);
+    cache.insert(std::string(3 * bytes, 'k'), 6.0f);
+    check(*cache.find("k0") == 0.0f && cache.find("k3") != nullptr && cache.find("k4") != nullptr,
+          "repeated and oversized keys leave the cache alone");
+    check(stats(cache) == "3 entries, " + std::to_string(3 * bytes) + " of " + std::to_string(3 * bytes)
+                          + " bytes, 8 hits, 2 misses, hit rate 80%", "stats " + stats(cache));
+
+    // --cache-bytes 0 stores nothing, every lookup misses
+    result_cache<float> disabled(0);
+    disabled.insert("k0", 0.0f);
+    check(disabled.find("k0") == nullptr && stats(disabled) == "0 entries, 0 of 0 bytes, 0 hits, 1 misses, hit rate 0%",
+          "stats of an empty budget " + stats(disabled));
+}
+
+int run_checks() {
+    checker check;
+    const std::pair<const char*, void (*)(checker&)> components[] = {
+        {"literals", check_literals}, {"constant expressions", check_constant_expressions}, {"tokenizer", check_tokenizer},
+        {"structural index", check_structural_index},
+        {"compiled expression", check_compiled_expression}, {"optimizer", check_optimizer}, {"dag", check_dag},
+        {"columns", check_columns}, {"shapes", check_shapes}, {"allocations", check_allocations}, {"jit", check_jit},
+        {"register machine", check_register_machine}, {"dispatch", check_dispatch},
+        {"native code", check_native}, {"tiers", check_tiers},
+        {"fork-join", check_fork_join}, {"stream", check_stream}, {"parallel", check_parallel},
+        {"big integer", check_big_integer}, {"result cache", check_result_cache}};
+    for (auto [name, function] : components) {
+        check.component(name);
+        function(check);
+    }
+
+    std::cout << check.checks() << " checks, " << check.failures() << " failed\n";
+    return check.failures() == 0 ? 0 : 1;
+}
+
+// usage message for command line options
+const std::string USAGEMSG = "usage: calculator [--bench] [--check] [--batch FILE [--threads N] [--tiered | --dag | --shapes | --integers | --native]]\n"
+                             "                  [--stream FILE] [--parallel FILE [--threads N]] [--cache-bytes N]\n"
+                             "                  [--tier-thresholds COMPILE,NATIVE] [--fast-math]\n"
+                             "--batch takes at most one of its modes, and --fast-math only applies to the REPL and --batch --tiered\n"
+                             "--fast-math reassociates + and * in the REPL and --tiered, it does not contract into fused multiply-adds\n";
+
+// count given on the command line, nullopt unless the whole argument is a decimal number that fits size_t
+std::optional<size_t> parse_count(std::string_view argument) {
+    size_t count = 0;
+    auto [end, error] = std::from_chars(argument.data(), argument.data() + argument.size(), count);
+    if (error != std::errc() || end != argument.data() + argument.size() || argument.empty()) {
+        return std::nullopt;
+    }
+    return count;
+}
+
+// main loop
+int main(int argc, char** argv) {
+    std::string batch_path, parallel_path;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t cache_bytes = 1 << 20;
+    std::pair<size_t, size_t> tier_thresholds = {4, 64};
+    bool tiered_batch = false;
+    bool fast_math = false;
+    bool shared_dag = false;
+    bool grouped_shapes = false;
+    bool exact_integers = false;
+    bool native_code = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--bench") {
+            run_benchmarks();
+            return 0;
+        } else if (argument == "--check") {
+            return run_checks();
+        } else if (argument == "--batch" && i + 1 < argc) {
+            batch_path = argv[++i];
+        } else if (argument == "--stream" && i + 1 < argc) {
+            return run_stream(argv[++i]);
+        } else if (argument == "--parallel" && i + 1 < argc) {
+            parallel_path = argv[++i];
+        } else if (argument == "--threads" && i + 1 < argc && parse_count(argv[i + 1]).has_value()) {
+            threads = parse_count(argv[++i]).value();
+        } else if (argument == "--cache-bytes" && i + 1 < argc && parse_count(argv[i + 1]).has_value()) {
+            cache_bytes = parse_count(argv[++i]).value();
+        } else if (argument == "--fast-math") {
+            fast_math = true;
+        } else if (argument == "--dag") {
+            shared_dag = true;
+        } else if (argument == "--shapes") {
+            grouped_shapes = true;
+        } else if (argument == "--integers") {
+            exact_integers = true;
+        } else if (argument == "--native") {
+            native_code = true;
+        } else if (argument == "--tiered") {
+            tiered_batch = true;
+        } else if (argument == "--tier-thresholds" && i + 1 < argc) {
+            std::string_view thresholds = argv[++i];
+            size_t comma = thresholds.find(',');
+            std::optional<size_t> compile = parse_count(thresholds.substr(0, comma));
+            std::optional<size_t> native = comma == std::string_view::npos ? SIZE_MAX : parse_count(thresholds.substr(comma + 1));
+            if (!compile.has_value() || !native.has_value()) {
+                std::cerr << USAGEMSG;
+                return 1;
+            }
+            tier_thresholds = {compile.value(), native.value()};
+        } else {
+            std::cerr << USAGEMSG;
+            return 1;
+        }
+    }
+
+    // one batch mode at a time and only with --batch, and fast math only where it is used: the REPL and --tiered
+    int batch_modes = tiered_batch + shared_dag + grouped_shapes + exact_integers + native_code;
+    bool repl = batch_path.empty() && parallel_path.empty();
+    if (batch_modes > 1 || (batch_modes > 0 && batch_path.empty()) || (!batch_path.empty() && !parallel_path.empty())
+        || (fast_math && !repl && !tiered_batch)) {
+        std::cerr << USAGEMSG;
+        return 1;
+    }
+
+    if (!parallel_path.empty()) {
+        return run_parallel(parallel_path, threads);
+    }
+    if (!batch_path.empty()) {
+        return run_batch(batch_path, threads, tiered_batch ? std::make_optional(tier_thresholds) : std::nullopt, fast_math,
+                         shared_dag, grouped_shapes, exact_integers, native_code);
+    }
+
+    std::optional<token<float>> previous_result = std::nullopt;
+    std::string input, key;
+    result_cache<float> cache(cache_bytes);
+    background_worker compiler;
+    tiered_engine<float> engine(compiler, tier_thresholds.first, tier_thresholds.second, fast_math);
+
+    while (true) {
+        std::cout << "> ";
+        if (previous_result.has_value()) {
+            std::cout << previous_result.value() << " ";
+        }
+
+        std::getline(std::cin, input);
+
+        input.erase(std::remove_if(input.begin(), input.end(), isspace), input.end());
+
+        if (input == "") {
+            previous_result = std::nullopt;
+            continue;
+        }
+
+        if (input == "help" || input == "h") {
+            std::cout << HELPMSG << "\n";
+            continue;
+        }
+
+        if (input == "stats") {
+            std::cout << "cache: " << cache << "\n";
+            continue;
+        }
+
+        if (input == "tiers") {
+            std::cout << engine;
+            continue;
+        }
+
+        if (input == "quit" || input == "q") {
+            break;
+        }
+
+        make_cache_key(key, input, previous_result);
+        std::optional<float> result;
+        if (const std::optional<float>* cached = cache.find(key)) {
+            result = *cached;
+            engine.record_hit(previous_result, input, !result.has_value());
+        } else {
+            result = engine.evaluate(previous_result, input);
+            cache.insert(key, result);
+        }
+        if (!result.has_value()) {
+            std::cout << "error\n";
+            previous_result = std::nullopt;
+            continue;
+        }
 
-        previous_result = std::make_optional(evaluate<float>(tokens));
+        previous_result = std::make_optional<token<float>>(result.value());
     }
 }
\ No newline at end of file